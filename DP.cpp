@@ -1 +1,2 @@
 #include "DP.hpp"
+#include "DP_batch.hpp"
@@ -16,28 +16,130 @@
 #include <numeric>
 #include <cmath>
 #include <math.h>
+#include <type_traits>
 
-#if (!IS_CXX_11) && !(__cplusplus == 201103L)
-  #include <Eigen/Dense>
-  using namespace Eigen;
-#else
+#if IS_CXX_11 || (__cplusplus == 201103L)
   #include "port_utils.hpp"
 #endif
 
 #include "utils.hpp"
 #include "score.hpp"
+#include "priority_sort.hpp"
 #include "LTSS.hpp"
+#include "DP_table.hpp"
+#include "DP_simd.hpp"
 
 #define UNUSED(expr) do { (void)(expr); } while (0)
 
+namespace SolverEngine {
+  enum class EngineMethod { Dense = 0,
+			    MonotoneArgmax = 1,
+			    LinearMemory = 2,
+			    Binned = 3,
+			    Auto = 4,
+			    Greedy = 5
+  };
+
+  // Peak bytes held by a solve, and the number of range score
+  // evaluations, counting an accumulated score as one per element
+  struct CostEstimate {
+    std::size_t bytes;
+    double cellEvaluations;
+  };
+} // namespace SolverEngine
+
+namespace DPSolverContext {
+  struct Context {
+    Context(SolverEngine::EngineMethod engine=SolverEngine::EngineMethod::Dense,
+	    int numThreads=1,
+	    int numBins=1024) :
+      engine{engine},
+      numThreads{numThreads},
+      numBins{numBins}
+    {}
+
+    // Dense scans every k in the recurrence, MonotoneArgmax uses the
+    // monotonicity of the optimal next start in i to fill each column
+    // by divide and conquer in O(n log n), LinearMemory keeps two score
+    // columns and recovers the partition by divide and conquer on T, in
+    // O(n) memory; it only applies without sweep_down or find_optimal_t.
+    // Binned is approximate, see numBins. Auto picks one from
+    // DPSolver::estimate_cost, see memoryBudget. Greedy is approximate:
+    // it cuts the priority-sorted points top-down at the best single cut
+    // of a block until there are T, in O(n log T) with the rational
+    // optimization, and bounds its gap over numBins bins as Binned does,
+    // in O(numBins^2 T) on the first request for the bound or the gap;
+    // it only applies without sweep_down or find_optimal_t
+    SolverEngine::EngineMethod engine;
+    // Rows of each column are filled in parallel, requires OpenMP
+    int numThreads;
+    // Binned engine only: the priority-sorted points are grouped into
+    // numBins quantile bins and the exact recurrence runs over the bins,
+    // so subset boundaries fall on bin edges. Falls back to the exact
+    // solve when n <= numBins or T > numBins
+    int numBins;
+    // Boundaries of a previous partition in priority order,
+    // 0 = warmStart[0] < ... < warmStart[T] = n. Dense and MonotoneArgmax
+    // then first search only within warmStartBand of each boundary, and
+    // redo the full search if a chosen boundary lands on the edge of its
+    // band. The result is optimal among partitions with boundaries in the
+    // bands, hence globally optimal if the optimal boundaries lie in them,
+    // but nothing certifies that: an interior maximum of a band can hide
+    // a better partition outside it. A heuristic, for callers that accept
+    // a near-optimal partition. Ignored with sweep_down or find_optimal_t
+    std::vector<int> warmStart;
+    int warmStartBand = 64;
+    // Priority order of a previous, similar problem, e.g. its
+    // get_priority_sortind_extern(); the sort then costs in proportion to
+    // how far the order moved. Any value gives the same result
+    std::vector<int> sortHint;
+    // Auto engine only: the exact engine with the fewest evaluations
+    // that fits in memoryBudget bytes, and in cellBudget evaluations if
+    // positive, else Binned with as many bins as fit. It may switch on
+    // the rational optimization, which drops the O(n^2) partial sums.
+    // Throws memoryBudgetException rather than allocate past the budget
+    std::size_t memoryBudget = std::size_t{1} << 30;
+    double cellBudget = 0.;
+    // Dense and MonotoneArgmax only: if set, the DP tables are memory
+    // mapped temporary files in this directory rather than held in RAM,
+    // for n too large for the tables to fit. Only a_, b_ and the sort
+    // stay resident, so use_rational_optimization should be set to avoid
+    // the O(n^2) partial sums
+    std::string tableDirectory;
+    // Dense, and the warm start band of either engine, Gaussian risk
+    // partitioning and RationalScore objectives with the rational
+    // optimization: skip blocks of next starts whose score bound can't
+    // beat the best found so far. Exact, the result is identical; see
+    // get_pruned_cells_extern(). Ignored by the full MonotoneArgmax
+    // search, whose rows scan too few blocks for the bounds to pay.
+    // Also ignored for the other objectives, which have no closed form
+    // bound from a block's extremes of the sums: Poisson's C log(C/B) is
+    // not monotone in C, the Gaussian multiple clustering score grows
+    // with signed C and is cut to 0 at C <= B, and without the rational
+    // optimization scores come from the partial sums table
+    bool prune = false;
+    // Bounds on the number of elements in each subset, enforced in the
+    // recurrence, so that a maxSegmentLength of L scans at most L next
+    // starts per entry; 0 leaves it unbounded. Bounded solves use the
+    // Dense or MonotoneArgmax engine, the others fall back to Dense, and
+    // no warm start. Throws segmentLengthException if no partition of n
+    // into T subsets, or into every S <= T with sweep_down or
+    // find_optimal_t, meets the bounds
+    int minSegmentLength = 1;
+    int maxSegmentLength = 0;
+  };
+} // namespace DPSolverContext
+
 using namespace Objectives;
 using namespace Utils;
+using namespace SolverEngine;
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType=RuntimePolicy>
 class DPSolver {
   using all_scores = std::pair<std::vector<std::vector<int> >, DataType>;
   using all_part_scores = std::vector<all_scores>;
 public:
+  // Both vector constructors delegate to the pointer one below
   DPSolver(std::vector<DataType> a,
 	   std::vector<DataType> b,
 	   int T,
@@ -47,23 +149,24 @@ public:
 	   DataType gamma=0.,
 	   int reg_power=1.,
 	   bool sweep_down=false,
-	   bool find_optimal_t=false
+	   bool find_optimal_t=false,
+	   DPSolverContext::Context context=DPSolverContext::Context{},
+	   DPWorkspace<DataType>* workspace=nullptr
 	   ) :
-    n_{static_cast<int>(a.size())},
-    T_{T},
-    a_{a},
-    b_{b},
-    optimal_score_{0.},
-    parametric_dist_{parametric_dist},
-    risk_partitioning_objective_{risk_partitioning_objective},
-    use_rational_optimization_{use_rational_optimization},
-    gamma_{gamma},
-    reg_power_{reg_power},
-    sweep_down_{sweep_down},
-    find_optimal_t_{find_optimal_t},
-    optimal_num_clusters_OLS_{0}
-    
-  { _init(); }
+    DPSolver(static_cast<int>(a.size()),
+	     T,
+	     a.data(),
+	     b.data(),
+	     parametric_dist,
+	     risk_partitioning_objective,
+	     use_rational_optimization,
+	     gamma,
+	     reg_power,
+	     sweep_down,
+	     find_optimal_t,
+	     std::move(context),
+	     workspace)
+  {}
 
   DPSolver(int n,
 	   int T,
@@ -75,12 +178,43 @@ public:
 	   DataType gamma=0.,
 	   int reg_power=1.,
 	   bool sweep_down=false,
-	   bool find_optimal_t=false
+	   bool find_optimal_t=false,
+	   DPSolverContext::Context context=DPSolverContext::Context{},
+	   DPWorkspace<DataType>* workspace=nullptr
+	   ) :
+    DPSolver(n,
+	     T,
+	     a.data(),
+	     b.data(),
+	     parametric_dist,
+	     risk_partitioning_objective,
+	     use_rational_optimization,
+	     gamma,
+	     reg_power,
+	     sweep_down,
+	     find_optimal_t,
+	     std::move(context),
+	     workspace)
+  {}
+
+  // Reads a[0:n], b[0:n] directly, e.g. armadillo memptr(); only the
+  // priority-sorted copy is kept
+  DPSolver(int n,
+	   int T,
+	   const DataType* a,
+	   const DataType* b,
+	   objective_fn parametric_dist=objective_fn::Gaussian,
+	   bool risk_partitioning_objective=false,
+	   bool use_rational_optimization=false,
+	   DataType gamma=0.,
+	   int reg_power=1.,
+	   bool sweep_down=false,
+	   bool find_optimal_t=false,
+	   DPSolverContext::Context context=DPSolverContext::Context{},
+	   DPWorkspace<DataType>* workspace=nullptr
 	   ) :
     n_{n},
     T_{T},
-    a_{a},
-    b_{b},
     optimal_score_{0.},
     parametric_dist_{parametric_dist},
     risk_partitioning_objective_{risk_partitioning_objective},
@@ -89,15 +223,70 @@ public:
     reg_power_{reg_power},
     sweep_down_{sweep_down},
     find_optimal_t_{find_optimal_t},
-    optimal_num_clusters_OLS_{0}
+    optimal_num_clusters_OLS_{0},
+    engine_{context.engine},
+    numThreads_{std::max(1, context.numThreads)},
+    numBins_{std::max(1, context.numBins)},
+    memoryBudget_{context.memoryBudget},
+    cellBudget_{context.cellBudget},
+    tableDirectory_{context.tableDirectory},
+    prune_{context.prune},
+    minSegment_{std::max(1, context.minSegmentLength)},
+    maxSegment_{context.maxSegmentLength},
+    prunedCells_{0},
+    score_upper_bound_{0.},
+    upperBoundPending_{false},
+    warmStart_{context.warmStart},
+    warmStartBand_{std::max(1, context.warmStartBand)},
+    warmStarted_{false},
+    workspace_{workspace},
+    sortHint_{std::move(context.sortHint)}
   
-  { _init(); }
+  { _init(a, b); }
 
-  std::vector<std::vector<int> > get_optimal_subsets_extern() const;
+  // Results are views into the solver, valid for its lifetime
+  const std::vector<std::vector<int> >& get_optimal_subsets_extern() const;
   DataType get_optimal_score_extern() const;
-  std::vector<DataType> get_score_by_subset_extern() const;
-  all_part_scores get_all_subsets_and_scores_extern() const;
+  const std::vector<DataType>& get_score_by_subset_extern() const;
+  // With sweep_down or find_optimal_t; the subsets are built on the
+  // first call, so concurrent first calls on one solver must be
+  // serialized
+  const all_part_scores& get_all_subsets_and_scores_extern() const;
+  // The partition into T subsets as T+1 offsets into the priority order:
+  // block s is get_priority_sortind_extern()[boundaries[s], boundaries[s+1]),
+  // and its sums of a and b are the block sums. The blocks are those of
+  // get_optimal_subsets_extern(), in priority rather than score order
+  const std::vector<int>& get_optimal_boundaries_extern() const;
+  const std::vector<double>& get_block_a_sums_extern() const;
+  const std::vector<double>& get_block_b_sums_extern() const;
   int get_optimal_num_clusters_OLS_extern() const;
+  // Upper bound on the unregularized optimal score for T subsets, and its
+  // gap to the score of the returned partition; the gap is 0 for the
+  // exact engines. The Greedy bound is computed on the first call, so
+  // concurrent first calls on one solver must be serialized
+  DataType get_score_upper_bound_extern() const;
+  DataType get_approximation_gap_extern() const;
+  // True if the banded search was kept and the full search skipped; the
+  // partition is then not certified optimal
+  bool get_warm_started_extern() const;
+  const std::vector<int>& get_priority_sortind_extern() const;
+  EngineMethod get_engine_extern() const;
+  // Candidate next starts skipped by Context::prune, over all columns
+  std::size_t get_pruned_cells_extern() const;
+  static CostEstimate estimate_cost(int n,
+				    int T,
+				    EngineMethod engine,
+				    bool use_rational_optimization,
+				    bool all_columns=false,
+				    int numBins=1024);
+  // Regularization path. Row 0 of the table holds the optimal score for
+  // every S <= T, so one solve answers any (gamma, reg_power) in O(T);
+  // partitions are backtracked on request and cached. Needs the Dense or
+  // MonotoneArgmax engine without a warm start, and, for the partitions,
+  // no workspace
+  const std::vector<DataType>& get_path_scores_extern() const;
+  int get_path_num_clusters_extern(DataType gamma, DataType reg_power) const;
+  const std::vector<std::vector<int> >& get_path_subsets_extern(int S);
   void print_maxScore_();
   void print_nextStart_();
     
@@ -106,8 +295,8 @@ private:
   int T_;
   std::vector<DataType> a_;
   std::vector<DataType> b_;
-  std::vector<std::vector<DataType> > maxScore_, maxScore_sec_;
-  std::vector<std::vector<int> > nextStart_, nextStart_sec_;
+  DPTable<DataType> maxScore_;
+  DPIndexTable nextStart_;
   std::vector<int> priority_sortind_;
   DataType optimal_score_;
   std::vector<std::vector<int> > subsets_;
@@ -119,9 +308,53 @@ private:
   int reg_power_;
   bool sweep_down_;
   bool find_optimal_t_;
-  all_part_scores subsets_and_scores_;
+  mutable all_part_scores subsets_and_scores_;
+  // allBoundaries_[S] is the partition into S subsets, until its subsets
+  // are built
+  mutable std::vector<std::vector<int> > allBoundaries_;
   int optimal_num_clusters_OLS_;
-  std::unique_ptr<ParametricContext> context_;
+  EngineMethod engine_;
+  int numThreads_;
+  int numBins_;
+  std::size_t memoryBudget_;
+  double cellBudget_;
+  std::string tableDirectory_;
+  bool prune_;
+  int minSegment_;
+  int maxSegment_;
+  std::size_t prunedCells_;
+  // The Greedy bound is left pending until requested
+  mutable DataType score_upper_bound_;
+  mutable bool upperBoundPending_;
+  std::vector<int> warmStart_;
+  int warmStartBand_;
+  bool warmStarted_;
+  // If set, the tables are swapped in from it for the solve and handed
+  // back after, also when it throws, so they are empty afterwards
+  DPWorkspace<DataType>* workspace_;
+  // consumed by sort_by_priority
+  std::vector<int> sortHint_;
+  // pathScores_[S] is the unregularized optimal score for S subsets,
+  // pathSubsets_[S] the partition, empty until requested
+  std::vector<DataType> pathScores_;
+  std::vector<std::vector<std::vector<int> > > pathSubsets_;
+  // offsets of the partition into T subsets, and a, b sums per block
+  std::vector<int> boundaries_;
+  std::vector<double> blockSumsA_;
+  std::vector<double> blockSumsB_;
+  // rows per parallel work item, a multiple of the cache line so that
+  // threads don't share lines of the same column
+  static constexpr int ROW_CHUNK = 64;
+  // Next starts are pruned in blocks of PRUNE_BLOCK. The bounds are the
+  // extremes of a_cum and b_cum over each block, and the max of the
+  // previous column; empty unless pruning
+  static constexpr int PRUNE_BLOCK = 64;
+  std::vector<double> blockMinA_;
+  std::vector<double> blockMaxA_;
+  std::vector<double> blockMinB_;
+  std::vector<DataType> blockMaxPrev_;
+  std::vector<std::vector<DataType> > partialSums_;
+  std::unique_ptr<ParametricContext<DataType> > context_;
   // XXX
   // Doesn't seem like it's needed
   std::unique_ptr<LTSSSolver<DataType>> LTSSSolver_;
@@ -129,17 +362,79 @@ private:
   void create();
   void createContext();
   void create_multiple_clustering_case();
+  template<typename ScoreFn>
+  void dispatch_range_score(ScoreFn&&);
+  template<typename ScoreFn>
+  std::pair<DataType, int> optimal_next_start(int, int, int, int, const ScoreFn&);
+  template<typename ScoreFn>
+  static constexpr bool is_prunable();
+  template<typename ScoreFn>
+  void block_cumulative_bounds(const ScoreFn&);
+  void block_column_bounds(int);
+  template<typename ScoreFn>
+  std::pair<DataType, int> optimal_next_start_pruned(int, int, int, int, const ScoreFn&);
+  template<typename ScoreFn>
+  void fill_column_dense(int, const ScoreFn&);
+  template<typename ScoreFn>
+  void fill_column_monotone(int, int, int, int, int, const ScoreFn&);
+  bool use_linear_memory() const;
+  bool segment_bounded() const;
+  int row_first(int) const;
+  int row_last(int) const;
+  int next_start_first(int, int) const;
+  int next_start_last(int, int) const;
+  void check_segment_lengths();
+  void init_column(int);
+  bool use_warm_start() const;
+  template<typename ScoreFn>
+  bool fill_columns_banded(const ScoreFn&);
+  template<typename ScoreFn>
+  std::vector<DataType> prefix_scores(int, int, int, const ScoreFn&);
+  template<typename ScoreFn>
+  std::vector<DataType> suffix_scores(int, int, int, const ScoreFn&);
+  template<typename ScoreFn>
+  void split_linear_memory(int, int, int, std::vector<int>&, const ScoreFn&);
+  std::vector<int> linear_memory_boundaries();
+  bool use_binned() const;
+  bool use_greedy() const;
+  std::vector<int> greedy_boundaries();
+  void select_engine();
+  std::vector<std::vector<int> > expand_bins(const std::vector<std::vector<int> >&, const std::vector<int>&) const;
+  void optimize_binned();
+  void compute_block_sums();
+  DataType binned_upper_bound(const std::vector<int>&) const;
+  std::vector<int> greedy_bound_edges() const;
+  std::vector<int> backtrack_boundaries(int) const;
   all_scores optimize_for_fixed_S(int);
+  all_scores partition_for_boundaries(const std::vector<int>&, std::vector<DataType>&) const;
+  all_scores optimize_for_boundaries(const std::vector<int>&);
+  DataType boundaries_score(const std::vector<int>&);
   void optimize();
   void optimize_multiple_clustering_case();
-  void sort_by_priority(std::vector<DataType>&, std::vector<DataType>&);
-  void reorder_subsets(std::vector<std::vector<int> >&, std::vector<DataType>&);
-  DataType compute_score(int, int);
+  void sort_by_priority(const DataType*, const DataType*);
+  void reorder_subsets(std::vector<std::vector<int> >&, std::vector<DataType>&) const;
+  DataType compute_score(int, int) const;
+  DataType range_score(int, int);
   DataType compute_ambient_score(DataType, DataType);
   void find_optimal_t();
-  void _init() { 
-    create();
-    optimize();
+  void _init(const DataType* a, const DataType* b) { 
+    if constexpr (!std::is_same<ScorePolicyType, RuntimePolicy>::value) {
+      // Objective is fixed by the policy, which scores from cumulative sums
+      parametric_dist_ = ScorePolicyType::objective;
+      risk_partitioning_objective_ = ScorePolicyType::risk_partitioning_objective;
+      use_rational_optimization_ = true;
+    }
+    // Every subset holds at least one point
+    if (T_ > n_)
+      throw partitionSizeException();
+    check_segment_lengths();
+    select_engine();
+    sort_by_priority(a, b);
+    {
+      DPWorkspaceLoan<DataType> loan{workspace_, maxScore_, nextStart_};
+      create();
+      optimize();
+    }
   }
 };
 
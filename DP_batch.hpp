@@ -0,0 +1,83 @@
+#ifndef __DP_BATCH_HPP__
+#define __DP_BATCH_HPP__
+
+#include <vector>
+#include <exception>
+#include <algorithm>
+#include <mutex>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#include "DP.hpp"
+
+namespace DPBatchContext {
+  template<typename DataType>
+  struct Problem {
+    Problem(std::vector<DataType> a,
+	    std::vector<DataType> b,
+	    int T,
+	    objective_fn parametric_dist=objective_fn::Gaussian,
+	    bool risk_partitioning_objective=false,
+	    bool use_rational_optimization=false,
+	    DPSolverContext::Context context=DPSolverContext::Context{}) :
+      a{a},
+      b{b},
+      T{T},
+      parametric_dist{parametric_dist},
+      risk_partitioning_objective{risk_partitioning_objective},
+      use_rational_optimization{use_rational_optimization},
+      context{context}
+    {}
+
+    std::vector<DataType> a;
+    std::vector<DataType> b;
+    int T;
+    objective_fn parametric_dist;
+    bool risk_partitioning_objective;
+    bool use_rational_optimization;
+    // Per-problem solver options. numThreads only takes effect with a
+    // single-thread batch, or if the caller enables nested parallelism,
+    // e.g. omp_set_max_active_levels; otherwise the problem's parallel
+    // regions run on the one batch thread that solves it
+    DPSolverContext::Context context;
+  };
+
+  template<typename DataType>
+  struct Result {
+    std::vector<std::vector<int> > subsets;
+    DataType optimal_score;
+    std::vector<DataType> score_by_subset;
+  };
+} // namespace DPBatchContext
+
+// Solves independent problems concurrently, one problem per thread at a
+// time. Each thread keeps its DP tables across problems and across calls
+// to solve(), so a batch of similar sizes allocates them once per thread.
+// Concurrent calls to solve() on one object take turns, as they would
+// otherwise share the workspaces.
+template<typename DataType>
+class DPBatchSolver {
+public:
+  using Problem = DPBatchContext::Problem<DataType>;
+  using Result = DPBatchContext::Result<DataType>;
+
+  DPBatchSolver(int numThreads=1) :
+    numThreads_{std::max(1, numThreads)},
+    workspaces_(numThreads_)
+  {}
+
+  // Results are in the order of problems; the first exception thrown by
+  // any problem is rethrown once all have finished
+  std::vector<Result> solve(const std::vector<Problem>&);
+
+private:
+  int numThreads_;
+  std::vector<DPWorkspace<DataType> > workspaces_;
+  std::mutex solveMutex_;
+};
+
+#include "DP_batch_impl.hpp"
+
+#endif
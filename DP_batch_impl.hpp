@@ -0,0 +1,53 @@
+#ifndef __DP_BATCH_IMPL_HPP__
+#define __DP_BATCH_IMPL_HPP__
+
+template<typename DataType>
+std::vector<typename DPBatchSolver<DataType>::Result>
+DPBatchSolver<DataType>::solve(const std::vector<Problem>& problems) {
+  std::lock_guard<std::mutex> lock{solveMutex_};
+  std::vector<Result> results(problems.size());
+  std::exception_ptr error = nullptr;
+
+  // Problem sizes vary, so they are handed out one at a time
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads_) if(numThreads_ > 1)
+  for (int p=0; p<static_cast<int>(problems.size()); ++p) {
+#ifdef _OPENMP
+    DPWorkspace<DataType>& workspace = workspaces_[omp_get_thread_num()];
+#else
+    DPWorkspace<DataType>& workspace = workspaces_[0];
+#endif
+    try {
+      const Problem& problem = problems[p];
+      DPSolver<DataType> dp{static_cast<int>(problem.a.size()),
+			    problem.T,
+			    problem.a.data(),
+			    problem.b.data(),
+			    problem.parametric_dist,
+			    problem.risk_partitioning_objective,
+			    problem.use_rational_optimization,
+			    0.,
+			    1,
+			    false,
+			    false,
+			    problem.context,
+			    &workspace};
+      results[p] = Result{dp.get_optimal_subsets_extern(),
+			  dp.get_optimal_score_extern(),
+			  dp.get_score_by_subset_extern()};
+    }
+    catch (...) {
+#pragma omp critical
+      {
+	if (!error)
+	  error = std::current_exception();
+      }
+    }
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+
+  return results;
+}
+
+#endif
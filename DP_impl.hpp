@@ -4,134 +4,1022 @@
 template<typename T>
 class TD;
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 void
-DPSolver<DataType>::sort_by_priority(std::vector<DataType>& a, std::vector<DataType>& b) {
-  std::vector<int> ind(a.size());
-  std::iota(ind.begin(), ind.end(), 0);
-
-  std::stable_sort(ind.begin(), ind.end(),
-		   [&a, &b](int i, int j) {
-		     return (a[i]/b[i]) < (a[j]/b[j]);
-		   });
-
-  priority_sortind_ = ind;
-
-  std::vector<DataType> a_s, b_s;
-  for (auto i : ind) {
-    a_s.push_back(a[i]);
-    b_s.push_back(b[i]);
+DPSolver<DataType, ScorePolicyType>::sort_by_priority(const DataType* a, const DataType* b) {
+  // Gathers the inputs into a_, b_ in priority order, the only copy made
+  if (sortHint_.empty()) {
+    priority_sortind_ = PrioritySort::sort_by_priority(a, b, n_, numThreads_);
+  }
+  else {
+    priority_sortind_ = PrioritySort::sort_by_priority(a, b, n_, sortHint_, numThreads_);
+    std::vector<int>().swap(sortHint_);
   }
 
-  std::copy(a_s.cbegin(), a_s.cend(), a.begin());
-  std::copy(b_s.cbegin(), b_s.cend(), b.begin());
+  a_.resize(n_);
+  b_.resize(n_);
+#pragma omp parallel for schedule(static) num_threads(numThreads_) if(numThreads_ > 1)
+  for (int i=0; i<n_; ++i) {
+    a_[i] = a[priority_sortind_[i]];
+    b_[i] = b[priority_sortind_[i]];
+  }
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 void 
-DPSolver<DataType>::createContext() {
+DPSolver<DataType, ScorePolicyType>::createContext() {
   // create reference to score function
   if (parametric_dist_ == objective_fn::Gaussian) {
-    context_ = std::make_unique<GaussianContext>(a_, 
-						 b_, 
-						 n_, 
-						 risk_partitioning_objective_,
-						 use_rational_optimization_);
+    context_ = std::make_unique<GaussianContext<DataType> >(a_.data(), 
+							    b_.data(), 
+							    n_, 
+							    risk_partitioning_objective_,
+							    use_rational_optimization_);
   }
   else if (parametric_dist_ == objective_fn::Poisson) {
-    context_ = std::make_unique<PoissonContext>(a_, 
-						b_, 
-						n_,
-						risk_partitioning_objective_,
-						use_rational_optimization_);
+    context_ = std::make_unique<PoissonContext<DataType> >(a_.data(), 
+							   b_.data(), 
+							   n_,
+							   risk_partitioning_objective_,
+							   use_rational_optimization_);
   }
   else if (parametric_dist_ == objective_fn::RationalScore) {
-    context_ = std::make_unique<RationalScoreContext>(a_, 
-						      b_, 
-						      n_,
-						      risk_partitioning_objective_,
-						      use_rational_optimization_);
+    context_ = std::make_unique<RationalScoreContext<DataType> >(a_.data(), 
+								 b_.data(), 
+								 n_,
+								 risk_partitioning_objective_,
+								 use_rational_optimization_);
   }
   else {
     throw distributionException();
   }
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 void 
-DPSolver<DataType>::create() {
+DPSolver<DataType, ScorePolicyType>::create() {
   // reset optimal_score_
   optimal_score_ = 0.;
 
-  // sort vectors by priority function G(x,y) = x/y
-  sort_by_priority(a_, b_);
+  // a_, b_ are sorted by priority function G(x,y) = x/y in _init()
 
   // create context
   createContext();
     
-  // Initialize matrix
-  maxScore_ = std::vector<std::vector<DataType> >(n_, std::vector<DataType>(T_+1, std::numeric_limits<DataType>::lowest()));
-  nextStart_ = std::vector<std::vector<int> >(n_, std::vector<int>(T_+1, -1));
   subsets_ = std::vector<std::vector<int> >(T_, std::vector<int>());
   score_by_subset_ = std::vector<DataType>(T_, 0.);
 
+  // No tables in linear memory, binned or greedy mode, the partition is
+  // recovered directly in optimize()
+  if (use_linear_memory() || use_binned() || use_greedy())
+    return;
+
+  // Initialize matrix. A mapped table is left as the zeros of a new file
+  // and its columns are set as they are filled, see init_column()
+  maxScore_.resize(n_, T_+1,
+		   tableDirectory_.empty() ? std::numeric_limits<DataType>::lowest() : DataType{},
+		   tableDirectory_);
+  nextStart_.resize(n_, T_+1, tableDirectory_);
+
   // Fill in first,second columns corresponding to T = 0,1
   for(int j=0; j<2; ++j) {
     for (int i=0; i<n_; ++i) {
-      maxScore_[i][j] = (j==0)?0.:compute_score(i,n_);
-      nextStart_[i][j] = (j==0)?-1:n_;
+      maxScore_(i, j) = (j==0)?0.:compute_score(i,n_);
+      nextStart_.set(i, j, (j==0)?0:n_);
     }
   }
+  // A single subset must satisfy the length bounds too
+  for (int i=0; i<n_; ++i) {
+    if ((i < row_first(1)) || (i > row_last(1)))
+      maxScore_(i, 1) = std::numeric_limits<DataType>::lowest();
+  }
 
   // Precompute partial sums
-  std::vector<std::vector<DataType> > partialSums;
-  partialSums = std::vector<std::vector<DataType> >(n_, std::vector<DataType>(n_, 0.));
-  for (int i=0; i<n_; ++i) {
-    for (int j=i; j<n_; ++j) {
-      partialSums[i][j] = compute_score(i, j);
+  // With the rational optimization the context answers range scores in
+  // O(1) from cumulative sums, so they are evaluated on demand instead
+  if (!use_rational_optimization_) {
+    partialSums_ = std::vector<std::vector<DataType> >(n_, std::vector<DataType>(n_, 0.));
+#pragma omp parallel for schedule(dynamic, ROW_CHUNK) num_threads(numThreads_) if(numThreads_ > 1)
+    for (int i=0; i<n_; ++i) {
+      for (int j=i; j<n_; ++j) {
+	partialSums_[i][j] = compute_score(i, j);
+      }
     }
   }
 
   // Fill in column-by-column from the left
+  dispatch_range_score([this](const auto& scorer) {
+      // MonotoneArgmax scans too few next starts per row for the block
+      // bounds to pay for themselves, so it only prunes in the band
+      bool warmStart = use_warm_start();
+      if constexpr (is_prunable<std::decay_t<decltype(scorer)> >()) {
+	if (prune_ && ((engine_ == EngineMethod::Dense) || warmStart))
+	  block_cumulative_bounds(scorer);
+      }
+
+      if (warmStart && (warmStarted_ = fill_columns_banded(scorer)))
+	return;
+      if (engine_ == EngineMethod::MonotoneArgmax)
+	std::vector<double>().swap(blockMinB_);
+
+      for(int j=2; j<=T_; ++j) {
+	init_column(j);
+	if (!blockMinB_.empty())
+	  block_column_bounds(j-1);
+	if (j == T_) {
+	  // Only need the initial entry in last column
+	  auto optimal = optimal_next_start(0, j, next_start_first(0, j), next_start_last(0, j), scorer);
+	  maxScore_(0, j) = optimal.first;
+	  nextStart_.set(0, j, optimal.second);
+	}
+	else if (engine_ == EngineMethod::MonotoneArgmax) {
+#pragma omp parallel num_threads(numThreads_) if(numThreads_ > 1)
+#pragma omp single
+	  fill_column_monotone(j, row_first(j), row_last(j), 1, n_-(j-1), scorer);
+	}
+	else {
+	  fill_column_dense(j, scorer);
+	}
+      }
+    });
+
+  std::vector<std::vector<DataType> >().swap(partialSums_);
+  std::vector<double>().swap(blockMinA_);
+  std::vector<double>().swap(blockMaxA_);
+  std::vector<double>().swap(blockMinB_);
+  std::vector<DataType>().swap(blockMaxPrev_);
+
+  // Off the band, row 0 of the columns S < T_ is not filled
+  if (!warmStarted_) {
+    pathScores_.assign(T_+1, 0.);
+    for (int S=1; S<=T_; ++S) {
+      pathScores_[S] = maxScore_(0, S);
+    }
+    pathSubsets_.assign(T_+1, std::vector<std::vector<int> >());
+  }
+}
+
+template<typename DataType, typename ScorePolicyType>
+void
+DPSolver<DataType, ScorePolicyType>::init_column(int j) {
+  // Entries a fill doesn't reach read as lowest. Only a mapped table
+  // needs this; setting the column just before it is filled keeps its
+  // pages from being touched earlier
+  if (!tableDirectory_.empty())
+    std::fill_n(maxScore_.column(j), n_, std::numeric_limits<DataType>::lowest());
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+void
+DPSolver<DataType, ScorePolicyType>::dispatch_range_score(ScoreFn&& fn) {
+  // Calls fn with the range score for this objective; the hot loops are
+  // instantiated per objective so that the score inlines into them
+  if constexpr (!std::is_same<ScorePolicyType, RuntimePolicy>::value) {
+    fn(CumulativeScore<ScorePolicyType>{context_->get_a_cum().data(), context_->get_b_cum().data()});
+  }
+  else if (use_rational_optimization_) {
+    dispatch_score_policy(parametric_dist_,
+			  risk_partitioning_objective_,
+			  context_->get_a_cum().data(),
+			  context_->get_b_cum().data(),
+			  std::forward<ScoreFn>(fn));
+  }
+  else {
+    fn([this](int i, int j) { return range_score(i, j); });
+  }
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+std::pair<DataType, int>
+DPSolver<DataType, ScorePolicyType>::optimal_next_start(int i, int j, int kFirst, int kLast, const ScoreFn& scorer) {
+  // First maximizer of scorer(i, k) + maxScore_(k, j-1) over k in [kFirst, kLast]
+  const DataType* prevScore = maxScore_.column(j-1);
+  if constexpr ((std::is_same<DataType, double>::value || std::is_same<DataType, float>::value) &&
+		SIMD::is_cumulative_score<ScoreFn>::value) {
+    if constexpr (is_prunable<ScoreFn>()) {
+      if (!blockMinB_.empty())
+	return optimal_next_start_pruned(i, j, kFirst, kLast, scorer);
+    }
+    // vectorized where the policy and the cpu allow it
+    auto optimal = SIMD::argmax<typename ScoreFn::policy, DataType>(scorer.a_cum, scorer.b_cum, prevScore, i, kFirst, kLast);
+    return std::make_pair(static_cast<DataType>(optimal.first), optimal.second);
+  }
+
   DataType score;
-  DataType maxScore;
+  DataType maxScore = std::numeric_limits<DataType>::lowest();
   int maxNextStart = -1;
-  for(int j=2; j<=T_; ++j) {
-    for (int i=0; i<n_; ++i) {
-      maxScore = std::numeric_limits<DataType>::lowest();
-      for (int k=i+1; k<=(n_-(j-1)); ++k) {
-	score = partialSums[i][k] + maxScore_[k][j-1];
-	if (score > maxScore) {
-	  maxScore = score;
-	  maxNextStart = k;
+  for (int k=kFirst; k<=kLast; ++k) {
+    score = scorer(i, k) + prevScore[k];
+    if (score > maxScore) {
+      maxScore = score;
+      maxNextStart = k;
+    }
+  }
+  return std::make_pair(maxScore, maxNextStart);
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+constexpr bool
+DPSolver<DataType, ScorePolicyType>::is_prunable() {
+  // The bounds need a score increasing in |C| and decreasing in B > 0,
+  // which holds for the C^2/B forms the SIMD kernel vectorizes. Others,
+  // e.g. Poisson's C log(C/B), are scanned without pruning
+  if constexpr ((std::is_same<DataType, double>::value || std::is_same<DataType, float>::value) &&
+		SIMD::is_cumulative_score<ScoreFn>::value)
+    return SIMD::vectorizable<typename ScoreFn::policy>::value;
+  else
+    return false;
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+void
+DPSolver<DataType, ScorePolicyType>::block_cumulative_bounds(const ScoreFn& scorer) {
+  int numBlocks = n_/PRUNE_BLOCK + 1;
+  blockMinA_.resize(numBlocks);
+  blockMaxA_.resize(numBlocks);
+  blockMinB_.resize(numBlocks);
+#pragma omp parallel for schedule(static) num_threads(numThreads_) if(numThreads_ > 1)
+  for (int block=0; block<numBlocks; ++block) {
+    int kFirst = block*PRUNE_BLOCK;
+    int kLast = std::min(n_, kFirst+PRUNE_BLOCK-1);
+    blockMinA_[block] = *std::min_element(scorer.a_cum+kFirst, scorer.a_cum+kLast+1);
+    blockMaxA_[block] = *std::max_element(scorer.a_cum+kFirst, scorer.a_cum+kLast+1);
+    blockMinB_[block] = *std::min_element(scorer.b_cum+kFirst, scorer.b_cum+kLast+1);
+  }
+}
+
+template<typename DataType, typename ScorePolicyType>
+void
+DPSolver<DataType, ScorePolicyType>::block_column_bounds(int j) {
+  // Next starts index rows of column j, which has n_ of them
+  int numBlocks = static_cast<int>(blockMinB_.size());
+  const DataType* score = maxScore_.column(j);
+  blockMaxPrev_.resize(numBlocks);
+#pragma omp parallel for schedule(static) num_threads(numThreads_) if(numThreads_ > 1)
+  for (int block=0; block<numBlocks; ++block) {
+    int kFirst = block*PRUNE_BLOCK;
+    int kLast = std::min(n_-1, kFirst+PRUNE_BLOCK-1);
+    blockMaxPrev_[block] = (kFirst > kLast) ? std::numeric_limits<DataType>::lowest() :
+      *std::max_element(score+kFirst, score+kLast+1);
+  }
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+std::pair<DataType, int>
+DPSolver<DataType, ScorePolicyType>::optimal_next_start_pruned(int i, int j, int kFirst, int kLast, const ScoreFn& scorer) {
+  // Over a block of next starts, C = a_cum[k] - a_cum[i] lies within the
+  // block's extremes of a_cum less a_cum[i], and B = b_cum[k] - b_cum[i]
+  // is at least its minimum of b_cum less b_cum[i]. As the score grows
+  // with |C|, falls with B > 0 and rounding is monotone, the score at
+  // those extremes plus the block max of column j-1 bounds every value
+  // the scan would compute in the block, rounding included. The block with
+  // the largest bound is scanned first; the others are then skipped if
+  // their bound can't beat it, or can only tie it from larger next
+  // starts. Ties go to the smaller next start, as in the unpruned scan.
+  using Policy = typename ScoreFn::policy;
+  const DataType* prevScore = maxScore_.column(j-1);
+  const double ai = scorer.a_cum[i], bi = scorer.b_cum[i];
+
+  auto bound = [&](int block) {
+    double B = blockMinB_[block] - bi;
+    if (!(B > 0.))
+      return std::numeric_limits<double>::max();
+    double C = std::max(std::abs(blockMaxA_[block] - ai), std::abs(blockMinA_[block] - ai));
+    return static_cast<double>(static_cast<DataType>(Policy::score(C, B) + blockMaxPrev_[block]));
+  };
+  auto scan = [&](int block) {
+    int first = std::max(kFirst, block*PRUNE_BLOCK);
+    int last = std::min(kLast, block*PRUNE_BLOCK+PRUNE_BLOCK-1);
+    return SIMD::argmax<Policy, DataType>(scorer.a_cum, scorer.b_cum, prevScore, i, first, last);
+  };
+  auto size = [&](int block) {
+    return std::min(kLast, block*PRUNE_BLOCK+PRUNE_BLOCK-1) - std::max(kFirst, block*PRUNE_BLOCK) + 1;
+  };
+
+  int blockFirst = kFirst/PRUNE_BLOCK, blockLast = kLast/PRUNE_BLOCK;
+  int seed = blockFirst;
+  double maxBound = std::numeric_limits<double>::lowest();
+  for (int block=blockFirst; block<=blockLast; ++block) {
+    double blockBound = bound(block);
+    if (blockBound > maxBound) {
+      maxBound = blockBound;
+      seed = block;
+    }
+  }
+
+  auto optimal = scan(seed);
+  std::size_t skipped = 0;
+  for (int block=blockFirst; block<=blockLast; ++block) {
+    if (block == seed)
+      continue;
+    double blockBound = bound(block);
+    if ((blockBound < optimal.first) ||
+	((blockBound == optimal.first) && (std::max(kFirst, block*PRUNE_BLOCK) > optimal.second))) {
+      skipped += size(block);
+      continue;
+    }
+    auto candidate = scan(block);
+    if ((candidate.second >= 0) &&
+	((candidate.first > optimal.first) ||
+	 ((candidate.first == optimal.first) && (candidate.second < optimal.second)))) {
+      optimal = candidate;
+    }
+  }
+
+  if (skipped) {
+#pragma omp atomic
+    prunedCells_ += skipped;
+  }
+  return std::make_pair(static_cast<DataType>(optimal.first), optimal.second);
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+void
+DPSolver<DataType, ScorePolicyType>::fill_column_dense(int j, const ScoreFn& scorer) {
+  // Rows outside [row_first(j), row_last(j)] cannot be split into j
+  // subsets within the length bounds, by default those i > n_-j
+  // Rows only read column j-1, so they are independent; work is handed out
+  // in blocks of ROW_CHUNK rows, dynamically as row i scans n_-j-i values
+#pragma omp parallel for schedule(dynamic, ROW_CHUNK) num_threads(numThreads_) if(numThreads_ > 1)
+  for (int i=row_first(j); i<=row_last(j); ++i) {
+    auto optimal = optimal_next_start(i, j, next_start_first(i, j), next_start_last(i, j), scorer);
+    maxScore_(i, j) = optimal.first;
+    nextStart_.set(i, j, optimal.second);
+  }
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+void
+DPSolver<DataType, ScorePolicyType>::fill_column_monotone(int j, int iFirst, int iLast, int kFirst, int kLast, const ScoreFn& scorer) {
+  // Divide and conquer over rows; with priority-sorted inputs the optimal
+  // next start is nondecreasing in i, so the argmax for the middle row
+  // bounds the search range of the rows above and below it.
+  if (iFirst > iLast)
+    return;
+
+  int i = iFirst + (iLast - iFirst)/2;
+  auto optimal = optimal_next_start(i, j, std::max(next_start_first(i, j), kFirst), std::min(next_start_last(i, j), kLast), scorer);
+  maxScore_(i, j) = optimal.first;
+  nextStart_.set(i, j, optimal.second);
+
+  // Halves are independent; spawn a task for the upper one when called
+  // from within a parallel region and the range is worth the overhead
+#pragma omp task if((iLast - iFirst) > ROW_CHUNK)
+  fill_column_monotone(j, iFirst, i-1, kFirst, optimal.second, scorer);
+  fill_column_monotone(j, i+1, iLast, optimal.second, kLast, scorer);
+}
+
+template<typename DataType, typename ScorePolicyType>
+bool
+DPSolver<DataType, ScorePolicyType>::segment_bounded() const {
+  return (minSegment_ > 1) || (maxSegment_ < n_);
+}
+
+template<typename DataType, typename ScorePolicyType>
+int
+DPSolver<DataType, ScorePolicyType>::row_first(int j) const {
+  // First row whose suffix splits into j subsets of at most maxSegment_
+  return static_cast<int>(std::max<long long>(0, n_ - static_cast<long long>(j)*maxSegment_));
+}
+
+template<typename DataType, typename ScorePolicyType>
+int
+DPSolver<DataType, ScorePolicyType>::row_last(int j) const {
+  // Last row whose suffix splits into j subsets of at least minSegment_
+  return static_cast<int>(n_ - static_cast<long long>(j)*minSegment_);
+}
+
+template<typename DataType, typename ScorePolicyType>
+int
+DPSolver<DataType, ScorePolicyType>::next_start_first(int i, int j) const {
+  // The subset starting at i has at least minSegment_ elements, and the
+  // j-1 after it at most maxSegment_ each
+  return static_cast<int>(std::max<long long>(i + minSegment_, n_ - static_cast<long long>(j-1)*maxSegment_));
+}
+
+template<typename DataType, typename ScorePolicyType>
+int
+DPSolver<DataType, ScorePolicyType>::next_start_last(int i, int j) const {
+  // The subset starting at i has at most maxSegment_ elements, and the
+  // j-1 after it at least minSegment_ each
+  return static_cast<int>(std::min<long long>(static_cast<long long>(i) + maxSegment_, n_ - static_cast<long long>(j-1)*minSegment_));
+}
+
+template<typename DataType, typename ScorePolicyType>
+void
+DPSolver<DataType, ScorePolicyType>::check_segment_lengths() {
+  if ((maxSegment_ <= 0) || (maxSegment_ > n_))
+    maxSegment_ = n_;
+  if (!segment_bounded())
+    return;
+
+  // Every partition size solved for must admit a partition
+  for (int S=((sweep_down_ || find_optimal_t_) ? 1 : T_); S<=T_; ++S) {
+    if ((static_cast<long long>(S)*minSegment_ > n_) || (static_cast<long long>(S)*maxSegment_ < n_))
+      throw segmentLengthException();
+  }
+
+  // The bounds live in the table recurrence
+  if ((engine_ == EngineMethod::LinearMemory) || (engine_ == EngineMethod::Binned) || (engine_ == EngineMethod::Greedy))
+    engine_ = EngineMethod::Dense;
+}
+
+template<typename DataType, typename ScorePolicyType>
+bool
+DPSolver<DataType, ScorePolicyType>::use_warm_start() const {
+  // The band only covers the path to T subsets, so the other partition
+  // sizes can't be read off the tables
+  if (warmStart_.empty() || sweep_down_ || find_optimal_t_ || segment_bounded())
+    return false;
+  if ((static_cast<int>(warmStart_.size()) != (T_+1)) || (warmStart_.front() != 0) || (warmStart_.back() != n_))
+    return false;
+  for (int s=0; s<T_; ++s) {
+    if (warmStart_[s] >= warmStart_[s+1])
+      return false;
+  }
+  return true;
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+bool
+DPSolver<DataType, ScorePolicyType>::fill_columns_banded(const ScoreFn& scorer) {
+  // The entry in column j on the optimal path is the start of subset T_-j,
+  // and its next start is the start of subset T_-j+1. Only rows and next
+  // starts within warmStartBand_ of the corresponding previous boundaries
+  // are searched, everything else stays at lowest. Returns false if a
+  // boundary of the resulting partition sits on a band edge that is not
+  // also a feasibility limit, as the optimum likely lies outside the band.
+  // An interior boundary is no proof that it doesn't.
+  for (int j=2; j<=T_; ++j) {
+    init_column(j);
+    if (!blockMinB_.empty())
+      block_column_bounds(j-1);
+    int s = T_ - j;
+    int iFirst = std::max(0, warmStart_[s]-warmStartBand_);
+    int iLast = (j == T_) ? 0 : std::min(n_-j, warmStart_[s]+warmStartBand_);
+    int kFirst = std::max(1, warmStart_[s+1]-warmStartBand_);
+    int kLast = std::min(n_-(j-1), warmStart_[s+1]+warmStartBand_);
+#pragma omp parallel for schedule(dynamic, ROW_CHUNK) num_threads(numThreads_) if(numThreads_ > 1)
+    for (int i=iFirst; i<=iLast; ++i) {
+      auto optimal = optimal_next_start(i, j, std::max(i+1, kFirst), kLast, scorer);
+      if (optimal.second >= 0) {
+	maxScore_(i, j) = optimal.first;
+	nextStart_.set(i, j, optimal.second);
+      }
+    }
+  }
+
+  if (maxScore_(0, T_) == std::numeric_limits<DataType>::lowest())
+    return false;
+
+  std::vector<int> boundaries = backtrack_boundaries(T_);
+  for (int s=1; s<T_; ++s) {
+    int bandFirst = warmStart_[s]-warmStartBand_;
+    int bandLast = warmStart_[s]+warmStartBand_;
+    if ((boundaries[s] <= bandFirst) && (bandFirst > (boundaries[s-1]+1)))
+      return false;
+    if ((boundaries[s] >= bandLast) && (bandLast < (n_-(T_-s))))
+      return false;
+  }
+  return true;
+}
+
+template<typename DataType, typename ScorePolicyType>
+bool
+DPSolver<DataType, ScorePolicyType>::use_linear_memory() const {
+  // Only applies when a single partition size is needed
+  return (engine_ == EngineMethod::LinearMemory) && !sweep_down_ && !find_optimal_t_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+std::vector<DataType>
+DPSolver<DataType, ScorePolicyType>::prefix_scores(int first, int last, int S, const ScoreFn& scorer) {
+  // Entry m-first is the optimal score of [first, m) split into S subsets,
+  // computed with two rolling columns
+  int len = last - first;
+  std::vector<DataType> prevScore(len+1, std::numeric_limits<DataType>::lowest());
+  std::vector<DataType> score(len+1, std::numeric_limits<DataType>::lowest());
+
+  for (int m=first+1; m<=last; ++m) {
+    prevScore[m-first] = scorer(first, m);
+  }
+
+  for (int t=2; t<=S; ++t) {
+    std::fill(score.begin(), score.end(), std::numeric_limits<DataType>::lowest());
+#pragma omp parallel for schedule(dynamic, ROW_CHUNK) num_threads(numThreads_) if(numThreads_ > 1)
+    for (int m=first+t; m<=last; ++m) {
+      DataType maxScore = std::numeric_limits<DataType>::lowest();
+      for (int k=first+t-1; k<m; ++k) {
+	maxScore = std::max<DataType>(maxScore, prevScore[k-first] + scorer(k, m));
+      }
+      score[m-first] = maxScore;
+    }
+    std::swap(prevScore, score);
+  }
+  return prevScore;
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+std::vector<DataType>
+DPSolver<DataType, ScorePolicyType>::suffix_scores(int first, int last, int S, const ScoreFn& scorer) {
+  // Entry i-first is the optimal score of [i, last) split into S subsets;
+  // the same recurrence as create(), with two rolling columns
+  int len = last - first;
+  std::vector<DataType> prevScore(len+1, std::numeric_limits<DataType>::lowest());
+  std::vector<DataType> score(len+1, std::numeric_limits<DataType>::lowest());
+
+  for (int i=first; i<last; ++i) {
+    prevScore[i-first] = scorer(i, last);
+  }
+
+  for (int t=2; t<=S; ++t) {
+    std::fill(score.begin(), score.end(), std::numeric_limits<DataType>::lowest());
+#pragma omp parallel for schedule(dynamic, ROW_CHUNK) num_threads(numThreads_) if(numThreads_ > 1)
+    for (int i=first; i<=(last-t); ++i) {
+      DataType maxScore = std::numeric_limits<DataType>::lowest();
+      for (int k=i+1; k<=(last-(t-1)); ++k) {
+	maxScore = std::max<DataType>(maxScore, scorer(i, k) + prevScore[k-first]);
+      }
+      score[i-first] = maxScore;
+    }
+    std::swap(prevScore, score);
+  }
+  return prevScore;
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
+void
+DPSolver<DataType, ScorePolicyType>::split_linear_memory(int first, int last, int S, std::vector<int>& boundaries, const ScoreFn& scorer) {
+  // Hirschberg-style divide step: the optimal split of [first, last) into
+  // S subsets passes through the m maximizing the optimal score of
+  // [first, m) into S/2 subsets plus that of [m, last) into the rest.
+  // Appends the interior boundaries in order.
+  if (S == 1)
+    return;
+
+  if ((last - first) == S) {
+    for (int i=first+1; i<last; ++i)
+      boundaries.push_back(i);
+    return;
+  }
+
+  int S1 = S/2, S2 = S - S1;
+  int mBest = -1;
+  {
+    std::vector<DataType> prefix = prefix_scores(first, last-S2, S1, scorer);
+    std::vector<DataType> suffix = suffix_scores(first+S1, last, S2, scorer);
+    DataType maxScore = std::numeric_limits<DataType>::lowest();
+    for (int m=first+S1; m<=(last-S2); ++m) {
+      DataType score = prefix[m-first] + suffix[m-first-S1];
+      if (score > maxScore) {
+	maxScore = score;
+	mBest = m;
+      }
+    }
+  }
+
+  split_linear_memory(first, mBest, S1, boundaries, scorer);
+  boundaries.push_back(mBest);
+  split_linear_memory(mBest, last, S2, boundaries, scorer);
+}
+
+template<typename DataType, typename ScorePolicyType>
+std::vector<int>
+DPSolver<DataType, ScorePolicyType>::linear_memory_boundaries() {
+  std::vector<int> boundaries{0};
+  boundaries.reserve(T_+1);
+  dispatch_range_score([this, &boundaries](const auto& scorer) {
+      split_linear_memory(0, n_, T_, boundaries, scorer);
+    });
+  boundaries.push_back(n_);
+  return boundaries;
+}
+
+template<typename DataType, typename ScorePolicyType>
+CostEstimate
+DPSolver<DataType, ScorePolicyType>::estimate_cost(int n,
+						   int T,
+						   EngineMethod engine,
+						   bool use_rational_optimization,
+						   bool all_columns,
+						   int numBins) {
+  const double nd = n, Td = T;
+  const std::size_t N = static_cast<std::size_t>(n);
+  const std::size_t cellBytes = sizeof(DataType) +
+    ((n <= static_cast<int>(std::numeric_limits<std::uint16_t>::max())) ? sizeof(std::uint16_t) : sizeof(std::uint32_t));
+
+  // Sorted copies of a, b and the permutation, and the sort's keys and
+  // double buffers while it runs
+  std::size_t bytes = N*(2*sizeof(DataType) + sizeof(int)) + 2*N*(sizeof(std::uint64_t) + sizeof(int));
+  if (use_rational_optimization)
+    bytes += 2*(N+1)*sizeof(double);
+  // A range score is O(1) from cumulative sums, otherwise it accumulates
+  // n/3 elements on average
+  const double rangeCost = use_rational_optimization ? 1. : nd/3.;
+  double cells = 0.;
+
+  // Engines that don't apply fall back to the dense fill
+  if ((engine == EngineMethod::LinearMemory) && all_columns)
+    engine = EngineMethod::Dense;
+  if ((engine == EngineMethod::Binned) && ((numBins >= n) || (T > numBins)))
+    engine = EngineMethod::Dense;
+
+  switch (engine) {
+  case EngineMethod::Dense:
+  case EngineMethod::MonotoneArgmax: {
+    bytes += N*static_cast<std::size_t>(T+1)*cellBytes;
+    if (!use_rational_optimization) {
+      // partial sums table, each entry accumulated once
+      bytes += N*N*sizeof(DataType);
+      cells += nd*nd*nd/6.;
+    }
+    double perColumn = (engine == EngineMethod::Dense) ? nd*nd/2. : 2.*nd*std::log2(std::max(2., nd));
+    cells += std::max(0., Td-2.)*perColumn + nd;
+    break;
+  }
+  case EngineMethod::LinearMemory:
+    // prefix and suffix columns of the top level split
+    bytes += 4*(N+1)*sizeof(DataType);
+    cells += (2./3.)*Td*nd*nd*rangeCost;
+    break;
+  case EngineMethod::Binned: {
+    // inner solve over the bins, then the upper bound DP
+    CostEstimate binned = estimate_cost(numBins, T, EngineMethod::Dense, use_rational_optimization, all_columns);
+    bytes += binned.bytes + 4*static_cast<std::size_t>(numBins+1)*sizeof(double);
+    cells += binned.cellEvaluations + Td*static_cast<double>(numBins)*numBins + nd;
+    break;
+  }
+  case EngineMethod::Greedy: {
+    // a scan of every block per round; the bound is only computed on
+    // request
+    bytes += 4*static_cast<std::size_t>(T+1)*sizeof(double);
+    cells += 3.*nd*std::ceil(std::log2(std::max(2., Td)))*rangeCost;
+    break;
+  }
+  default:
+    break;
+  }
+
+  return CostEstimate{bytes, cells};
+}
+
+template<typename DataType, typename ScorePolicyType>
+void
+DPSolver<DataType, ScorePolicyType>::select_engine() {
+  if (engine_ != EngineMethod::Auto)
+    return;
+
+  bool allColumns = sweep_down_ || find_optimal_t_;
+  auto fits = [this](const CostEstimate& cost) {
+    return (cost.bytes <= memoryBudget_) && ((cellBudget_ <= 0.) || (cost.cellEvaluations <= cellBudget_));
+  };
+
+  // Exact engines first, the cheapest that fits. Scores from cumulative
+  // sums agree with accumulated ones up to rounding and need no O(n^2)
+  // partial sums, so they are tried even if not requested
+  bool found = false;
+  double minCells = std::numeric_limits<double>::max();
+  EngineMethod engineSelected = engine_;
+  bool rationalSelected = use_rational_optimization_;
+  for (bool rational : {use_rational_optimization_, true}) {
+    for (EngineMethod engine : {EngineMethod::Dense, EngineMethod::MonotoneArgmax, EngineMethod::LinearMemory}) {
+      if ((engine == EngineMethod::LinearMemory) && (allColumns || segment_bounded()))
+	continue;
+      CostEstimate cost = estimate_cost(n_, T_, engine, rational, allColumns);
+      if (fits(cost) && (cost.cellEvaluations < minCells)) {
+	minCells = cost.cellEvaluations;
+	engineSelected = engine;
+	rationalSelected = rational;
+	found = true;
+      }
+    }
+  }
+  if (found) {
+    engine_ = engineSelected;
+    use_rational_optimization_ = rationalSelected;
+    return;
+  }
+
+  // Approximate, with as many bins as fit and at least one per subset
+  use_rational_optimization_ = true;
+  for (int numBins=std::min(numBins_, n_-1); (numBins>=T_) && !segment_bounded(); numBins/=2) {
+    if (fits(estimate_cost(n_, T_, EngineMethod::Binned, true, allColumns, numBins))) {
+      engine_ = EngineMethod::Binned;
+      numBins_ = numBins;
+      return;
+    }
+  }
+
+  throw memoryBudgetException();
+}
+
+template<typename DataType, typename ScorePolicyType>
+bool
+DPSolver<DataType, ScorePolicyType>::use_binned() const {
+  // Binning only pays when there are fewer bins than points, and needs
+  // at least one bin per subset
+  return (engine_ == EngineMethod::Binned) && (numBins_ < n_) && (T_ <= numBins_);
+}
+
+template<typename DataType, typename ScorePolicyType>
+bool
+DPSolver<DataType, ScorePolicyType>::use_greedy() const {
+  // Only applies when a single partition size is needed
+  return (engine_ == EngineMethod::Greedy) && !sweep_down_ && !find_optimal_t_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+std::vector<int>
+DPSolver<DataType, ScorePolicyType>::greedy_boundaries() {
+  // Blocks [first, last) of the priority order, each with its best cut,
+  // the one that most increases the summed score, found by a scan over the
+  // block. Each round cuts the blocks with the largest gains, as many as
+  // are still needed, so a round at least doubles the blocks up to T; the
+  // best cuts of the new blocks are independent and found in parallel.
+  struct Block {
+    int first;
+    int last;
+    int cut;
+    DataType gain;
+  };
+
+  std::vector<int> boundaries;
+  dispatch_range_score([this, &boundaries](const auto& scorer) {
+      auto best_cut = [&scorer](Block& block) {
+	block.cut = -1;
+	block.gain = std::numeric_limits<DataType>::lowest();
+	DataType whole = scorer(block.first, block.last);
+	for (int k=block.first+1; k<block.last; ++k) {
+	  DataType gain = scorer(block.first, k) + scorer(k, block.last) - whole;
+	  if (gain > block.gain) {
+	    block.gain = gain;
+	    block.cut = k;
+	  }
+	}
+	// No comparable gain, e.g. all NaN where b sums to 0: cut in the
+	// middle, after any block with a real gain, so that every block of
+	// two or more points has a cut and T_ <= n_ blocks are always reached
+	if ((block.cut < 0) && ((block.last - block.first) > 1))
+	  block.cut = block.first + (block.last - block.first)/2;
+      };
+
+      std::vector<Block> blocks{Block{0, n_, -1, 0.}};
+      best_cut(blocks[0]);
+      while (static_cast<int>(blocks.size()) < T_) {
+	// Largest gains first, ties to the leftmost block
+	std::vector<int> order(blocks.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&blocks](int i, int j) {
+	    return blocks[i].gain > blocks[j].gain;
+	  });
+	int numCuts = T_ - static_cast<int>(blocks.size());
+	std::vector<bool> isCut(blocks.size(), false);
+	for (int ind : order) {
+	  if (numCuts == 0)
+	    break;
+	  if (blocks[ind].cut >= 0) {
+	    isCut[ind] = true;
+	    --numCuts;
+	  }
+	}
+
+	std::vector<Block> next;
+	std::vector<int> fresh;
+	next.reserve(T_);
+	for (size_t b=0; b<blocks.size(); ++b) {
+	  if (isCut[b]) {
+	    fresh.push_back(static_cast<int>(next.size()));
+	    next.push_back(Block{blocks[b].first, blocks[b].cut, -1, 0.});
+	    fresh.push_back(static_cast<int>(next.size()));
+	    next.push_back(Block{blocks[b].cut, blocks[b].last, -1, 0.});
+	  }
+	  else {
+	    next.push_back(blocks[b]);
+	  }
+	}
+	blocks.swap(next);
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads_) if(numThreads_ > 1)
+	for (size_t f=0; f<fresh.size(); ++f) {
+	  best_cut(blocks[fresh[f]]);
 	}
       }
-      maxScore_[i][j] = maxScore;
-      nextStart_[i][j] = maxNextStart;
-      // Only need the initial entry in last column
-      if (j == T_)
-	break;
+
+      for (const auto& block : blocks)
+	boundaries.push_back(block.first);
+      boundaries.push_back(n_);
+    });
+  return boundaries;
+}
+
+template<typename DataType, typename ScorePolicyType>
+std::vector<std::vector<int> >
+DPSolver<DataType, ScorePolicyType>::expand_bins(const std::vector<std::vector<int> >& binSubsets,
+						 const std::vector<int>& edges) const {
+  // Replaces each bin by its points, in priority order
+  std::vector<std::vector<int> > subsets(binSubsets.size(), std::vector<int>());
+  for (size_t s=0; s<binSubsets.size(); ++s) {
+    for (int bin : binSubsets[s]) {
+      for (int i=edges[bin]; i<edges[bin+1]; ++i) {
+	subsets[s].push_back(priority_sortind_[i]);
+      }
     }
   }
+  return subsets;
 }
 
-template<typename DataType>
-typename DPSolver<DataType>::all_scores
-DPSolver<DataType>::optimize_for_fixed_S(int S) {
+template<typename DataType, typename ScorePolicyType>
+void
+DPSolver<DataType, ScorePolicyType>::optimize_binned() {
+  // Bin b holds the priority-sorted points [edges[b], edges[b+1]); the
+  // bins have equal counts up to rounding
+  std::vector<int> edges(numBins_+1);
+  for (int bin=0; bin<=numBins_; ++bin) {
+    edges[bin] = static_cast<int>((static_cast<long long>(bin) * n_) / numBins_);
+  }
+
+  std::vector<DataType> a_bin(numBins_, 0.), b_bin(numBins_, 0.);
+  for (int bin=0; bin<numBins_; ++bin) {
+    for (int i=edges[bin]; i<edges[bin+1]; ++i) {
+      a_bin[bin] += a_[i];
+      b_bin[bin] += b_[i];
+    }
+  }
+
+  // The ratio of a bin's sums lies between the ratios of its points, so
+  // the bins are already in priority order; solve exactly over them
+  DPSolverContext::Context context{EngineMethod::Dense, numThreads_};
+  DPSolver<DataType, ScorePolicyType> binned{numBins_,
+					     T_,
+					     a_bin.data(),
+					     b_bin.data(),
+					     parametric_dist_,
+					     risk_partitioning_objective_,
+					     use_rational_optimization_,
+					     gamma_,
+					     reg_power_,
+					     sweep_down_,
+					     find_optimal_t_,
+					     context};
+
+  subsets_ = expand_bins(binned.subsets_, edges);
+  boundaries_.resize(binned.boundaries_.size());
+  for (size_t s=0; s<boundaries_.size(); ++s) {
+    boundaries_[s] = edges[binned.boundaries_[s]];
+  }
+  optimal_score_ = binned.optimal_score_;
+  score_by_subset_ = binned.score_by_subset_;
+  optimal_num_clusters_OLS_ = binned.optimal_num_clusters_OLS_;
+  subsets_and_scores_ = binned.get_all_subsets_and_scores_extern();
+  for (auto& subsets_and_score : subsets_and_scores_) {
+    subsets_and_score.first = expand_bins(subsets_and_score.first, edges);
+  }
+
+  score_upper_bound_ = binned_upper_bound(edges);
+  compute_block_sums();
+}
+
+template<typename DataType, typename ScorePolicyType>
+void
+DPSolver<DataType, ScorePolicyType>::compute_block_sums() {
+  // From the cumulative sums where the context has them
+  int S = static_cast<int>(boundaries_.size()) - 1;
+  blockSumsA_.assign(std::max(S, 0), 0.);
+  blockSumsB_.assign(std::max(S, 0), 0.);
+  const auto& a_cum = context_->get_a_cum();
+  const auto& b_cum = context_->get_b_cum();
+  for (int s=0; s<S; ++s) {
+    if (!a_cum.empty()) {
+      blockSumsA_[s] = a_cum[boundaries_[s+1]] - a_cum[boundaries_[s]];
+      blockSumsB_[s] = b_cum[boundaries_[s+1]] - b_cum[boundaries_[s]];
+    }
+    else {
+      blockSumsA_[s] = std::accumulate(a_.cbegin()+boundaries_[s], a_.cbegin()+boundaries_[s+1], 0.);
+      blockSumsB_[s] = std::accumulate(b_.cbegin()+boundaries_[s], b_.cbegin()+boundaries_[s+1], 0.);
+    }
+  }
+}
+
+template<typename DataType, typename ScorePolicyType>
+std::vector<int>
+DPSolver<DataType, ScorePolicyType>::greedy_bound_edges() const {
+  // Equal-count bins, at least one per subset
+  int numBins = std::max(T_, std::min(numBins_, n_));
+  std::vector<int> edges(numBins+1);
+  for (int bin=0; bin<=numBins; ++bin) {
+    edges[bin] = static_cast<int>((static_cast<long long>(bin) * n_) / numBins);
+  }
+  return edges;
+}
+
+template<typename DataType, typename ScorePolicyType>
+DataType
+DPSolver<DataType, ScorePolicyType>::binned_upper_bound(const std::vector<int>& edges) const {
+  // An optimal partition of the points into T subsets cuts through at most
+  // T-1 bins. Relax it by scoring each cut bin as singletons, charged one
+  // cut, and each run of uncut bins between them as a single subset. With
+  // b > 0 the subset scores are convex and positively homogeneous in the
+  // sums, hence subadditive, so neither step decreases the score. The
+  // bound is the best such configuration, found by a DP over bins in
+  // O(numBins^2 T).
+  int numBins = static_cast<int>(edges.size()) - 1;
+  std::vector<double> a_cum(numBins+1, 0.), b_cum(numBins+1, 0.);
+  for (int bin=0; bin<numBins; ++bin) {
+    a_cum[bin+1] = a_cum[bin];
+    b_cum[bin+1] = b_cum[bin];
+    for (int i=edges[bin]; i<edges[bin+1]; ++i) {
+      a_cum[bin+1] += a_[i];
+      b_cum[bin+1] += b_[i];
+    }
+  }
+
+  DataType upperBound = 0.;
+  auto bound = [this, &edges, &upperBound, numBins](const auto& scorer) {
+    using Policy = typename std::decay_t<decltype(scorer)>::policy;
+    std::vector<DataType> shattered(numBins, 0.);
+    for (int bin=0; bin<numBins; ++bin) {
+      for (int i=edges[bin]; i<edges[bin+1]; ++i) {
+	shattered[bin] += Policy::score(a_[i], b_[i]);
+      }
+    }
+
+    // prevBound[bin] bounds bins [bin, numBins) with at most t-1 cuts
+    std::vector<DataType> prevBound(numBins+1, 0.), bound_t(numBins+1, 0.);
+    for (int bin=0; bin<numBins; ++bin) {
+      prevBound[bin] = scorer(bin, numBins);
+    }
+    for (int t=2; t<=T_; ++t) {
+#pragma omp parallel for schedule(dynamic, ROW_CHUNK) num_threads(numThreads_) if(numThreads_ > 1)
+      for (int bin=0; bin<numBins; ++bin) {
+	// no further cuts
+	DataType maxScore = scorer(bin, numBins);
+	for (int k=bin; k<numBins; ++k) {
+	  // uncut run [bin, k), then a cut at edge k or through bin k
+	  DataType run = (k > bin) ? scorer(bin, k) : 0.;
+	  if (k > bin)
+	    maxScore = std::max<DataType>(maxScore, run + prevBound[k]);
+	  maxScore = std::max<DataType>(maxScore, run + shattered[k] + prevBound[k+1]);
+	}
+	bound_t[bin] = maxScore;
+      }
+      std::swap(prevBound, bound_t);
+    }
+    upperBound = prevBound[0];
+  };
+
+  if constexpr (!std::is_same<ScorePolicyType, RuntimePolicy>::value) {
+    bound(CumulativeScore<ScorePolicyType>{a_cum.data(), b_cum.data()});
+  }
+  else {
+    dispatch_score_policy(parametric_dist_, risk_partitioning_objective_, a_cum.data(), b_cum.data(), bound);
+  }
+  return upperBound;
+}
+
+template<typename DataType, typename ScorePolicyType>
+std::vector<int>
+DPSolver<DataType, ScorePolicyType>::backtrack_boundaries(int S) const {
+  // boundaries[s] is the start of subset s in priority order, boundaries[S] = n_
+  std::vector<int> boundaries(S+1, n_);
+  int currentInd = 0;
+  for (int t=S; t>0; --t) {
+    boundaries[S-t] = currentInd;
+    currentInd = nextStart_(currentInd, t);
+  }
+  return boundaries;
+}
+
+template<typename DataType, typename ScorePolicyType>
+typename DPSolver<DataType, ScorePolicyType>::all_scores
+DPSolver<DataType, ScorePolicyType>::optimize_for_fixed_S(int S) {
   // Pick out associated maxScores element
-  int currentInd = 0, nextInd = 0;
+  return optimize_for_boundaries(backtrack_boundaries(S));
+}
+
+template<typename DataType, typename ScorePolicyType>
+typename DPSolver<DataType, ScorePolicyType>::all_scores
+DPSolver<DataType, ScorePolicyType>::partition_for_boundaries(const std::vector<int>& boundaries,
+							      std::vector<DataType>& score_by_subset) const {
+  int S = static_cast<int>(boundaries.size()) - 1;
   DataType optimal_score = 0.;
   auto subsets = std::vector<std::vector<int> >(S, std::vector<int>());
-  auto score_by_subset = std::vector<DataType>(S, 0.);
+  score_by_subset.assign(S, 0.);
 
-  for (int t=S; t>0; --t) {
-    nextInd = nextStart_[currentInd][t];
-    for (int i=currentInd; i<nextInd; ++i) {
-      subsets[S-t].push_back(priority_sortind_[i]);
-    }
-    score_by_subset[S-t] = compute_score(currentInd, nextInd);
-    optimal_score += score_by_subset[S-t];
-    currentInd = nextInd;
+  for (int s=0; s<S; ++s) {
+    subsets[s].assign(priority_sortind_.cbegin()+boundaries[s], priority_sortind_.cbegin()+boundaries[s+1]);
+    score_by_subset[s] = compute_score(boundaries[s], boundaries[s+1]);
+    optimal_score += score_by_subset[s];
   }
 
   if (!risk_partitioning_objective_) {
@@ -141,16 +1029,40 @@ DPSolver<DataType>::optimize_for_fixed_S(int S) {
   // subtract regularization term
   optimal_score -= gamma_ * std::pow(S, reg_power_);
 
-  // Retain score_by_subsets if S is maximal
-  if (S == T_)
+  return all_scores{subsets, optimal_score};
+}
+
+template<typename DataType, typename ScorePolicyType>
+typename DPSolver<DataType, ScorePolicyType>::all_scores
+DPSolver<DataType, ScorePolicyType>::optimize_for_boundaries(const std::vector<int>& boundaries) {
+  std::vector<DataType> score_by_subset;
+  auto optimal = partition_for_boundaries(boundaries, score_by_subset);
+
+  // Retain score_by_subsets, boundaries if S is maximal
+  if ((static_cast<int>(boundaries.size()) - 1) == T_) {
     score_by_subset_ = score_by_subset;
+    boundaries_ = boundaries;
+  }
 
-  return all_scores{subsets, optimal_score};
+  return optimal;
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
+DataType
+DPSolver<DataType, ScorePolicyType>::boundaries_score(const std::vector<int>& boundaries) {
+  // The score optimize_for_boundaries() returns, without the subsets
+  int S = static_cast<int>(boundaries.size()) - 1;
+  DataType optimal_score = 0.;
+  for (int s=0; s<S; ++s) {
+    optimal_score += compute_score(boundaries[s], boundaries[s+1]);
+  }
+  optimal_score -= gamma_ * std::pow(S, reg_power_);
+  return optimal_score;
+}
+
+template<typename DataType, typename ScorePolicyType>
 void
-DPSolver<DataType>::find_optimal_t() {
+DPSolver<DataType, ScorePolicyType>::find_optimal_t() {
   std::vector<DataType> X; X.resize(subsets_and_scores_.size()); std::iota(X.begin(), X.end(), 1.);
   std::vector<DataType> scores, score_diffs;
   scores.resize(subsets_and_scores_.size()); score_diffs.resize(subsets_and_scores_.size());
@@ -161,69 +1073,96 @@ DPSolver<DataType>::find_optimal_t() {
     el = log(el);
   for (auto& el : score_diffs)
     el = log(el);
-  
-  Eigen::MatrixXf X_mat = Eigen::MatrixXf::Zero(score_diffs.size()-2, 2);
-  Eigen::VectorXf y_vec = Eigen::VectorXf::Zero(score_diffs.size()-2);
-  
-  for (size_t i=0; i<score_diffs.size()-2; ++i) {
-    X_mat(i,0) = X[i+2];
-    X_mat(i,1) = 1.;
-    y_vec(i) = score_diffs[i+2];
+
+  // Least squares line through (X[i], score_diffs[i]), i >= 2, in closed
+  // form, and the point furthest below it
+  int numPoints = static_cast<int>(score_diffs.size()) - 2;
+  double xMean = 0., yMean = 0.;
+  for (int i=0; i<numPoints; ++i) {
+    xMean += X[i+2];
+    yMean += score_diffs[i+2];
   }
-  
-  // OLS solution is a matrix of shape (2,1)
-  Eigen::MatrixXf beta_hat = X_mat.colPivHouseholderQr().solve(y_vec);
-  
-  // Compute residuals
-  Eigen::VectorXf resids = Eigen::VectorXf::Zero(score_diffs.size()-2);
+  xMean /= std::max(numPoints, 1);
+  yMean /= std::max(numPoints, 1);
+  double sxy = 0., sxx = 0.;
+  for (int i=0; i<numPoints; ++i) {
+    sxy += (X[i+2] - xMean) * (score_diffs[i+2] - yMean);
+    sxx += (X[i+2] - xMean) * (X[i+2] - xMean);
+  }
+  double slope = (sxx > 0.) ? sxy/sxx : 0.;
+  double intercept = yMean - slope * xMean;
+
   int bestInd = 0;
-  DataType minResid = std::numeric_limits<DataType>::max();
-  for (int i=0; i<static_cast<int>(score_diffs.size())-2; ++i) {
-    resids(i) = y_vec(i) - beta_hat(0) * X_mat(i,0) - beta_hat(1) * X_mat(i,1);
-    if (resids(i) < minResid) {
+  double minResid = std::numeric_limits<double>::max();
+  for (int i=0; i<numPoints; ++i) {
+    double resid = score_diffs[i+2] - slope * X[i+2] - intercept;
+    if (resid < minResid) {
       bestInd = i;
-      minResid = resids(i);
+      minResid = resid;
     }
   }
   optimal_num_clusters_OLS_ = bestInd + 1;
-  subsets_ = subsets_and_scores_[optimal_num_clusters_OLS_].first;
+  subsets_ = allBoundaries_.empty() ?
+    subsets_and_scores_[optimal_num_clusters_OLS_].first :
+    optimize_for_boundaries(allBoundaries_[optimal_num_clusters_OLS_]).first;
   optimal_score_ = subsets_and_scores_[optimal_num_clusters_OLS_].second;
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 void
-DPSolver<DataType>::optimize() {
+DPSolver<DataType, ScorePolicyType>::optimize() {
+  if (use_binned()) {
+    optimize_binned();
+    return;
+  }
+
   if (sweep_down_ || find_optimal_t_) {
-    int S;
+    // Backtracks only read the tables, so the partitions for every S are
+    // found in parallel, as boundaries; subsets are built on request by
+    // get_all_subsets_and_scores_extern()
     subsets_and_scores_ = all_part_scores{static_cast<size_t>(T_+1)};
-    auto beg = subsets_and_scores_.rend();
-    for (auto it=subsets_and_scores_.rbegin(); it!=subsets_and_scores_.rend(); ++it) {
-      S = static_cast<int>(std::distance(it, beg)) - 1;
-      if (S >= 1) {
-	auto optimal = optimize_for_fixed_S(S);
-	it->first = optimal.first;
-	it->second = optimal.second;
-      }
+    allBoundaries_.assign(T_+1, std::vector<int>());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads_) if(numThreads_ > 1)
+    for (int S=1; S<=T_; ++S) {
+      allBoundaries_[S] = backtrack_boundaries(S);
+      subsets_and_scores_[S].second = boundaries_score(allBoundaries_[S]);
     }
+    // score_by_subset_, boundaries_ for T_
+    optimize_for_boundaries(allBoundaries_[T_]);
     if (find_optimal_t_) {
-#if (!IS_CXX_11) && !(__cplusplus == 201103L) 
       find_optimal_t();
-#else
-      optimal_num_clusters_OLS_ = -1;
-#endif
     }
   }
+  else if (use_linear_memory()) {
+    auto optimal = optimize_for_boundaries(linear_memory_boundaries());
+    subsets_ = optimal.first;
+    optimal_score_ = optimal.second;
+  }
+  else if (use_greedy()) {
+    auto optimal = optimize_for_boundaries(greedy_boundaries());
+    subsets_ = optimal.first;
+    optimal_score_ = optimal.second;
+
+    // The bound costs more than the solve, so it waits for a request
+    upperBoundPending_ = true;
+    compute_block_sums();
+    return;
+  }
   else {
     auto optimal = optimize_for_fixed_S(T_);
     subsets_ = optimal.first;
     optimal_score_ = optimal.second;
   }
+
+  // Exact engines attain the bound
+  score_upper_bound_ = std::accumulate(score_by_subset_.cbegin(), score_by_subset_.cend(), DataType{0.});
+  compute_block_sums();
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 void
-DPSolver<DataType>::reorder_subsets(std::vector<std::vector<int> >& subsets, 
-			  std::vector<DataType>& score_by_subsets) {
+DPSolver<DataType, ScorePolicyType>::reorder_subsets(std::vector<std::vector<int> >& subsets, 
+			  std::vector<DataType>& score_by_subsets) const {
   std::vector<int> ind(subsets.size(), 0);
   std::iota(ind.begin(), ind.end(), 0.);
 
@@ -249,15 +1188,15 @@ DPSolver<DataType>::reorder_subsets(std::vector<std::vector<int> >& subsets,
   
 }
 
-template<typename DataType>
-std::vector<std::vector<int> >
-DPSolver<DataType>::get_optimal_subsets_extern() const {
+template<typename DataType, typename ScorePolicyType>
+const std::vector<std::vector<int> >&
+DPSolver<DataType, ScorePolicyType>::get_optimal_subsets_extern() const {
   return subsets_;
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 DataType
-DPSolver<DataType>::get_optimal_score_extern() const {
+DPSolver<DataType, ScorePolicyType>::get_optimal_score_extern() const {
   if (risk_partitioning_objective_) {
     return optimal_score_;
   }
@@ -266,52 +1205,165 @@ DPSolver<DataType>::get_optimal_score_extern() const {
   }
 }
 
-template<typename DataType>
-std::vector<DataType>
-DPSolver<DataType>::get_score_by_subset_extern() const {
+template<typename DataType, typename ScorePolicyType>
+const std::vector<DataType>&
+DPSolver<DataType, ScorePolicyType>::get_score_by_subset_extern() const {
   return score_by_subset_;
 }
 
-template<typename DataType>
-typename DPSolver<DataType>::all_part_scores 
-DPSolver<DataType>::get_all_subsets_and_scores_extern() const {
+template<typename DataType, typename ScorePolicyType>
+const typename DPSolver<DataType, ScorePolicyType>::all_part_scores&
+DPSolver<DataType, ScorePolicyType>::get_all_subsets_and_scores_extern() const {
+  if (!allBoundaries_.empty()) {
+    std::vector<DataType> score_by_subset;
+    for (int S=1; S<=T_; ++S) {
+      subsets_and_scores_[S].first = partition_for_boundaries(allBoundaries_[S], score_by_subset).first;
+    }
+    std::vector<std::vector<int> >().swap(allBoundaries_);
+  }
   return subsets_and_scores_;
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 int
-DPSolver<DataType>::get_optimal_num_clusters_OLS_extern() const {
+DPSolver<DataType, ScorePolicyType>::get_optimal_num_clusters_OLS_extern() const {
   return optimal_num_clusters_OLS_;
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
+DataType
+DPSolver<DataType, ScorePolicyType>::get_score_upper_bound_extern() const {
+  if (upperBoundPending_) {
+    score_upper_bound_ = binned_upper_bound(greedy_bound_edges());
+    upperBoundPending_ = false;
+  }
+  return score_upper_bound_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+DataType
+DPSolver<DataType, ScorePolicyType>::get_approximation_gap_extern() const {
+  return get_score_upper_bound_extern() - std::accumulate(score_by_subset_.cbegin(), score_by_subset_.cend(), DataType{0.});
+}
+
+template<typename DataType, typename ScorePolicyType>
+bool
+DPSolver<DataType, ScorePolicyType>::get_warm_started_extern() const {
+  return warmStarted_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+const std::vector<int>&
+DPSolver<DataType, ScorePolicyType>::get_priority_sortind_extern() const {
+  return priority_sortind_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+EngineMethod
+DPSolver<DataType, ScorePolicyType>::get_engine_extern() const {
+  return engine_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+const std::vector<int>&
+DPSolver<DataType, ScorePolicyType>::get_optimal_boundaries_extern() const {
+  return boundaries_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+const std::vector<double>&
+DPSolver<DataType, ScorePolicyType>::get_block_a_sums_extern() const {
+  return blockSumsA_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+const std::vector<double>&
+DPSolver<DataType, ScorePolicyType>::get_block_b_sums_extern() const {
+  return blockSumsB_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+std::size_t
+DPSolver<DataType, ScorePolicyType>::get_pruned_cells_extern() const {
+  return prunedCells_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+const std::vector<DataType>&
+DPSolver<DataType, ScorePolicyType>::get_path_scores_extern() const {
+  if (pathScores_.empty())
+    throw regularizationPathException();
+  return pathScores_;
+}
+
+template<typename DataType, typename ScorePolicyType>
+int
+DPSolver<DataType, ScorePolicyType>::get_path_num_clusters_extern(DataType gamma, DataType reg_power) const {
+  if (pathScores_.empty())
+    throw regularizationPathException();
+
+  // Smallest S on ties
+  int bestS = 1;
+  DataType bestScore = std::numeric_limits<DataType>::lowest();
+  for (int S=1; S<=T_; ++S) {
+    DataType score = pathScores_[S] - gamma * std::pow(S, reg_power);
+    if (score > bestScore) {
+      bestScore = score;
+      bestS = S;
+    }
+  }
+  return bestS;
+}
+
+template<typename DataType, typename ScorePolicyType>
+const std::vector<std::vector<int> >&
+DPSolver<DataType, ScorePolicyType>::get_path_subsets_extern(int S) {
+  if (pathScores_.empty() || (S < 1) || (S > T_) || (nextStart_.cols() != (T_+1)))
+    throw regularizationPathException();
+  if (pathScores_[S] == std::numeric_limits<DataType>::lowest())
+    throw segmentLengthException();
+
+  if (pathSubsets_[S].empty())
+    pathSubsets_[S] = optimize_for_boundaries(backtrack_boundaries(S)).first;
+  return pathSubsets_[S];
+}
+
+template<typename DataType, typename ScorePolicyType>
 void
-DPSolver<DataType>::print_maxScore_() {
+DPSolver<DataType, ScorePolicyType>::print_maxScore_() {
 
-  for (int i=0; i<n_; ++i) {
-    std::copy(maxScore_[i].cbegin(), maxScore_[i].cend(), std::ostream_iterator<DataType>(std::cout, " "));
+  for (int i=0; i<maxScore_.rows(); ++i) {
+    for (int j=0; j<maxScore_.cols(); ++j)
+      std::cout << maxScore_(i, j) << " ";
     std::cout << std::endl;
   }
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 void
-DPSolver<DataType>::print_nextStart_() {
-  for (int i=0; i<n_; ++i) {
-    std::copy(nextStart_[i].cbegin(), nextStart_[i].cend(), std::ostream_iterator<int>(std::cout, " "));
+DPSolver<DataType, ScorePolicyType>::print_nextStart_() {
+  for (int i=0; i<nextStart_.rows(); ++i) {
+    for (int j=0; j<nextStart_.cols(); ++j)
+      std::cout << nextStart_(i, j) << " ";
     std::cout << std::endl;
   }
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 DataType
-DPSolver<DataType>::compute_score(int i, int j) {
+DPSolver<DataType, ScorePolicyType>::compute_score(int i, int j) const {
   return context_->compute_score(i, j);
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
+DataType
+DPSolver<DataType, ScorePolicyType>::range_score(int i, int j) {
+  return partialSums_.empty() ? compute_score(i, j) : partialSums_[i][j];
+}
+
+template<typename DataType, typename ScorePolicyType>
 DataType
-DPSolver<DataType>::compute_ambient_score(DataType a, DataType b) {
+DPSolver<DataType, ScorePolicyType>::compute_ambient_score(DataType a, DataType b) {
   return context_->compute_ambient_score(a, b);
 }
 
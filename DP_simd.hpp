@@ -0,0 +1,221 @@
+#ifndef __DP_SIMD_HPP__
+#define __DP_SIMD_HPP__
+
+#include <limits>
+#include <utility>
+#include <type_traits>
+
+#include "score.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define DP_SIMD_X86 1
+  #include <immintrin.h>
+#else
+  #define DP_SIMD_X86 0
+#endif
+
+// Argmax kernel for the DP recurrence,
+//   first maximizer over k in [kFirst, kLast] of score(i, k) + prevScore[k],
+// with the range score evaluated from cumulative sums. The AVX2 and
+// AVX-512 versions keep a running max and argmax per lane and reduce to the
+// smallest k among the lane maxima, so ties resolve as in the scalar loop.
+// Every lane performs the same IEEE operations, in the same order, as
+// ScorePolicy::score, so results are bit-identical across instruction sets.
+// The previous column may be float; scores are then computed in double
+// from the double cumulative sums and rounded to float after adding the
+// previous column, as the scalar loop does when it stores to a float.
+namespace SIMD {
+  enum class InstructionSet { Scalar = 0,
+			      AVX2 = 1,
+			      AVX512 = 2
+  };
+
+  inline InstructionSet detect_instruction_set() {
+#if DP_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+      return InstructionSet::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+      return InstructionSet::AVX2;
+#endif
+    return InstructionSet::Scalar;
+  }
+
+  inline InstructionSet instruction_set() {
+    static const InstructionSet instructionSet = detect_instruction_set();
+    return instructionSet;
+  }
+
+  // Policies with a vectorized score; the others only have the scalar loop
+  template<typename ScorePolicyType>
+  struct vectorizable : std::false_type {};
+
+  template<>
+  struct vectorizable<ScorePolicy<objective_fn::Gaussian, true> > : std::true_type {};
+
+  template<bool RiskPartitioning>
+  struct vectorizable<ScorePolicy<objective_fn::RationalScore, RiskPartitioning> > : std::true_type {};
+
+  template<typename ScoreFn>
+  struct is_cumulative_score : std::false_type {};
+
+  template<typename ScorePolicyType>
+  struct is_cumulative_score<CumulativeScore<ScorePolicyType> > : std::true_type {};
+
+  template<typename ScorePolicyType, typename PrevType>
+  inline std::pair<double, int> argmax_scalar(const double* a_cum,
+					      const double* b_cum,
+					      const PrevType* prevScore,
+					      int i,
+					      int kFirst,
+					      int kLast,
+					      double maxScore=std::numeric_limits<double>::lowest(),
+					      int maxInd=-1) {
+    double score;
+    for (int k=kFirst; k<=kLast; ++k) {
+      score = static_cast<PrevType>(ScorePolicyType::score(a_cum[k] - a_cum[i], b_cum[k] - b_cum[i]) + prevScore[k]);
+      if (score > maxScore) {
+	maxScore = score;
+	maxInd = k;
+      }
+    }
+    return std::make_pair(maxScore, maxInd);
+  }
+
+#if DP_SIMD_X86
+  template<typename ScorePolicyType, typename PrevType>
+  __attribute__((target("avx2")))
+  std::pair<double, int> argmax_avx2(const double* a_cum,
+				     const double* b_cum,
+				     const PrevType* prevScore,
+				     int i,
+				     int kFirst,
+				     int kLast) {
+    constexpr int W = 4;
+    const __m256d ai = _mm256_set1_pd(a_cum[i]);
+    const __m256d bi = _mm256_set1_pd(b_cum[i]);
+    const __m256d two = _mm256_set1_pd(2.);
+    const __m256d step = _mm256_set1_pd(static_cast<double>(W));
+    __m256d maxScore = _mm256_set1_pd(std::numeric_limits<double>::lowest());
+    __m256d maxInd = _mm256_set1_pd(-1.);
+    __m256d ind = _mm256_setr_pd(kFirst, kFirst+1, kFirst+2, kFirst+3);
+
+    int k = kFirst;
+    for (; (k+W-1)<=kLast; k+=W) {
+      __m256d C = _mm256_sub_pd(_mm256_loadu_pd(a_cum+k), ai);
+      __m256d B = _mm256_sub_pd(_mm256_loadu_pd(b_cum+k), bi);
+      __m256d score = _mm256_mul_pd(C, C);
+      if (ScorePolicyType::objective == objective_fn::Gaussian)
+	score = _mm256_div_pd(score, two);
+      score = _mm256_div_pd(score, B);
+      if constexpr (std::is_same<PrevType, float>::value) {
+	score = _mm256_add_pd(score, _mm256_cvtps_pd(_mm_loadu_ps(prevScore+k)));
+	score = _mm256_cvtps_pd(_mm256_cvtpd_ps(score));
+      }
+      else {
+	score = _mm256_add_pd(score, _mm256_loadu_pd(prevScore+k));
+      }
+      __m256d gt = _mm256_cmp_pd(score, maxScore, _CMP_GT_OQ);
+      maxScore = _mm256_blendv_pd(maxScore, score, gt);
+      maxInd = _mm256_blendv_pd(maxInd, ind, gt);
+      ind = _mm256_add_pd(ind, step);
+    }
+
+    alignas(32) double laneScore[W], laneInd[W];
+    _mm256_store_pd(laneScore, maxScore);
+    _mm256_store_pd(laneInd, maxInd);
+    double bestScore = std::numeric_limits<double>::lowest();
+    int bestInd = -1;
+    for (int l=0; l<W; ++l) {
+      int lInd = static_cast<int>(laneInd[l]);
+      if ((lInd >= 0) && ((laneScore[l] > bestScore) ||
+			  ((laneScore[l] == bestScore) && (lInd < bestInd)))) {
+	bestScore = laneScore[l];
+	bestInd = lInd;
+      }
+    }
+    return argmax_scalar<ScorePolicyType, PrevType>(a_cum, b_cum, prevScore, i, k, kLast, bestScore, bestInd);
+  }
+
+  template<typename ScorePolicyType, typename PrevType>
+  __attribute__((target("avx512f")))
+  std::pair<double, int> argmax_avx512(const double* a_cum,
+				       const double* b_cum,
+				       const PrevType* prevScore,
+				       int i,
+				       int kFirst,
+				       int kLast) {
+    constexpr int W = 8;
+    const __m512d ai = _mm512_set1_pd(a_cum[i]);
+    const __m512d bi = _mm512_set1_pd(b_cum[i]);
+    const __m512d two = _mm512_set1_pd(2.);
+    const __m512d step = _mm512_set1_pd(static_cast<double>(W));
+    __m512d maxScore = _mm512_set1_pd(std::numeric_limits<double>::lowest());
+    __m512d maxInd = _mm512_set1_pd(-1.);
+    __m512d ind = _mm512_setr_pd(kFirst, kFirst+1, kFirst+2, kFirst+3,
+				 kFirst+4, kFirst+5, kFirst+6, kFirst+7);
+
+    int k = kFirst;
+    for (; (k+W-1)<=kLast; k+=W) {
+      __m512d C = _mm512_sub_pd(_mm512_loadu_pd(a_cum+k), ai);
+      __m512d B = _mm512_sub_pd(_mm512_loadu_pd(b_cum+k), bi);
+      __m512d score = _mm512_mul_pd(C, C);
+      if (ScorePolicyType::objective == objective_fn::Gaussian)
+	score = _mm512_div_pd(score, two);
+      score = _mm512_div_pd(score, B);
+      if constexpr (std::is_same<PrevType, float>::value) {
+	// maskz forms, the unmasked ones read an undefined source register
+	score = _mm512_add_pd(score, _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(prevScore+k)));
+	score = _mm512_maskz_cvtps_pd(0xFF, _mm512_maskz_cvtpd_ps(0xFF, score));
+      }
+      else {
+	score = _mm512_add_pd(score, _mm512_loadu_pd(prevScore+k));
+      }
+      __mmask8 gt = _mm512_cmp_pd_mask(score, maxScore, _CMP_GT_OQ);
+      maxScore = _mm512_mask_blend_pd(gt, maxScore, score);
+      maxInd = _mm512_mask_blend_pd(gt, maxInd, ind);
+      ind = _mm512_add_pd(ind, step);
+    }
+
+    alignas(64) double laneScore[W], laneInd[W];
+    _mm512_store_pd(laneScore, maxScore);
+    _mm512_store_pd(laneInd, maxInd);
+    double bestScore = std::numeric_limits<double>::lowest();
+    int bestInd = -1;
+    for (int l=0; l<W; ++l) {
+      int lInd = static_cast<int>(laneInd[l]);
+      if ((lInd >= 0) && ((laneScore[l] > bestScore) ||
+			  ((laneScore[l] == bestScore) && (lInd < bestInd)))) {
+	bestScore = laneScore[l];
+	bestInd = lInd;
+      }
+    }
+    return argmax_scalar<ScorePolicyType, PrevType>(a_cum, b_cum, prevScore, i, k, kLast, bestScore, bestInd);
+  }
+#endif
+
+  template<typename ScorePolicyType, typename PrevType>
+  inline std::pair<double, int> argmax(const double* a_cum,
+				       const double* b_cum,
+				       const PrevType* prevScore,
+				       int i,
+				       int kFirst,
+				       int kLast) {
+#if DP_SIMD_X86
+    if constexpr (vectorizable<ScorePolicyType>::value) {
+      switch (instruction_set()) {
+      case InstructionSet::AVX512:
+	return argmax_avx512<ScorePolicyType, PrevType>(a_cum, b_cum, prevScore, i, kFirst, kLast);
+      case InstructionSet::AVX2:
+	return argmax_avx2<ScorePolicyType, PrevType>(a_cum, b_cum, prevScore, i, kFirst, kLast);
+      default:
+	break;
+      }
+    }
+#endif
+    return argmax_scalar<ScorePolicyType, PrevType>(a_cum, b_cum, prevScore, i, kFirst, kLast);
+  }
+
+} // namespace SIMD
+
+#endif
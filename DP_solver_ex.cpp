@@ -144,5 +144,126 @@ auto main() -> int {
     std::cout << ltss_score << "\n";
   }
 
-  return 0;
+  // Greedy engine against the exact solve on the same inputs
+  std::cout << "\n========\nGREEDY VS EXACT\n========\n";
+  for (int i=0; i<NUM_TRIALS; ++i) {
+    std::generate(a.begin(), a.end(), gena);
+    std::generate(b.begin(), b.end(), genb);
+
+    auto dp_exact = DPSolver<double>(n, T, a, b,
+				    objective_fn::Gaussian,
+				    true,
+				    true);
+    auto dp_greedy = DPSolver<double>(n, T, a, b,
+				     objective_fn::Gaussian,
+				     true,
+				     true,
+				     0.0,
+				     1.0,
+				     false,
+				     false,
+				     DPSolverContext::Context{EngineMethod::Greedy});
+    auto exact_score = dp_exact.get_optimal_score_extern();
+    auto greedy_score = dp_greedy.get_optimal_score_extern();
+
+    std::cout << "TRIAL: " << i << " exact score: " << exact_score
+	      << " greedy score: " << greedy_score
+	      << " relative gap: " << (exact_score - greedy_score)/exact_score
+	      << " bound on gap: " << dp_greedy.get_approximation_gap_extern()
+	      << std::endl;
+  }
+
+  // Partition of every 4th point of a sorted input, extended to all the
+  // points by g/h thresholds. The subsample's points must get back their
+  // blocks, and the blocks must stay ranges of the sorted input
+  std::cout << "\n========\nSUBSAMPLE EXTENSION\n========\n";
+  int mismatches = 0;
+  for (int i=0; i<NUM_TRIALS; ++i) {
+    std::generate(a.begin(), a.end(), [&dista, &mersenne_engine]() { return dista(mersenne_engine); });
+    std::sort(a.begin(), a.end());
+    std::fill(b.begin(), b.end(), 1.);
+
+    std::vector<double> aSub, bSub;
+    for (int j=0; j<n; j+=4) {
+      aSub.push_back(a[j]);
+      bSub.push_back(b[j]);
+    }
+    int m = static_cast<int>(aSub.size());
+    auto dp_sub = DPSolver<double>(m, T, aSub, bSub,
+				   objective_fn::RationalScore,
+				   true,
+				   true);
+    const auto& sortind = dp_sub.get_priority_sortind_extern();
+    const auto& boundaries = dp_sub.get_optimal_boundaries_extern();
+    auto block = PrioritySort::extend_blocks(a.data(), b.data(), n,
+					     aSub.data(), bSub.data(),
+					     sortind, boundaries);
+
+    int trial_mismatches = 0;
+    for (int s=0; s<T; ++s) {
+      for (int k=boundaries[s]; k<boundaries[s+1]; ++k) {
+	trial_mismatches += block[4*sortind[k]] != s;
+      }
+    }
+    for (int j=1; j<n; ++j) {
+      trial_mismatches += block[j] < block[j-1];
+    }
+    mismatches += trial_mismatches;
+
+    std::cout << "TRIAL: " << i << " subsample: " << m
+	      << " points: " << n
+	      << " mismatches: " << trial_mismatches
+	      << std::endl;
+  }
+
+  // Pruned scan against the full scan on inputs where next starts tie.
+  // With a = 2b every partition scores the same, and the one large b
+  // gives block 3 the largest bound, so from row 63 on the backtracked
+  // path blocks 1 and 2 are scanned before it and tie its best score.
+  // Ties must go to the smallest next start, as in the full scan. The
+  // trials then draw a from a few integers, where many blocks tie
+  std::cout << "\n========\nPRUNED VS UNPRUNED\n========\n";
+  DPSolverContext::Context pruneContext{EngineMethod::Dense};
+  pruneContext.prune = true;
+  auto prune_mismatches = [&pruneContext](int m, int S, const std::vector<double>& c, const std::vector<double>& d) {
+    auto dp_full = DPSolver<double>(m, S, c, d,
+				    objective_fn::RationalScore,
+				    true,
+				    true);
+    auto dp_pruned = DPSolver<double>(m, S, c, d,
+				      objective_fn::RationalScore,
+				      true,
+				      true,
+				      0.0,
+				      1.0,
+				      false,
+				      false,
+				      pruneContext);
+    return std::make_pair(static_cast<int>(dp_full.get_optimal_subsets_extern() != dp_pruned.get_optimal_subsets_extern()),
+			  dp_pruned.get_pruned_cells_extern());
+  };
+
+  std::vector<double> bTie(1000, 1.), aTie(1000);
+  bTie[200] = 1.e5;
+  std::transform(bTie.begin(), bTie.end(), aTie.begin(), [](double x) { return 2.*x; });
+  auto tied = prune_mismatches(1000, 70, aTie, bTie);
+  mismatches += tied.first;
+  std::cout << "TIED: pruned cells: " << tied.second
+	    << " mismatches: " << tied.first
+	    << std::endl;
+
+  std::uniform_int_distribution<int> distTie(1, 3);
+  for (int i=0; i<NUM_TRIALS; ++i) {
+    std::generate(a.begin(), a.end(), [&distTie, &mersenne_engine]() { return distTie(mersenne_engine); });
+    std::fill(b.begin(), b.end(), 1.);
+
+    auto trial = prune_mismatches(n, T, a, b);
+    mismatches += trial.first;
+
+    std::cout << "TRIAL: " << i << " pruned cells: " << trial.second
+	      << " mismatches: " << trial.first
+	      << std::endl;
+  }
+
+  return (mismatches == 0) ? 0 : 1;
 }
@@ -0,0 +1,184 @@
+#ifndef __DP_TABLE_HPP__
+#define __DP_TABLE_HPP__
+
+#include <vector>
+#include <limits>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "utils.hpp"
+
+// Releases a table mapped from a temporary file
+struct DPTableUnmap {
+  std::size_t bytes;
+  void operator()(void* data) const { munmap(data, bytes); }
+};
+
+// Column-major DP table; column j is contiguous, so the recurrence, which
+// reads column j-1 down its rows, walks memory sequentially. The whole
+// table is a single allocation. Given a directory, the allocation is a
+// shared mapping of an unlinked temporary file there instead, so that the
+// kernel writes columns back as they are filled and pages them in again
+// on access; the file is removed with the mapping.
+template<typename ValueType>
+class DPTable {
+public:
+  DPTable() = default;
+  DPTable(int numRows, int numCols, ValueType fill, const std::string& directory="") {
+    resize(numRows, numCols, fill, directory);
+  }
+
+  void resize(int numRows, int numCols, ValueType fill, const std::string& directory="") {
+    // Shape is set last, so a table whose mapping failed is left empty
+    std::size_t size = static_cast<std::size_t>(numRows)*static_cast<std::size_t>(numCols);
+    numRows_ = numCols_ = 0;
+    if (directory.empty() || (size == 0)) {
+      mapped_.reset();
+      data_.assign(size, fill);
+      begin_ = data_.data();
+    }
+    else {
+      std::vector<ValueType>().swap(data_);
+      mapped_.reset();
+      mapped_ = map_file(directory, size*sizeof(ValueType));
+      begin_ = mapped_.get();
+      // A new file reads as zeros, so a zero fill touches no pages
+      if (fill != ValueType{})
+	std::fill_n(begin_, size, fill);
+    }
+    numRows_ = numRows;
+    numCols_ = numCols;
+  }
+
+  void clear() {
+    numRows_ = numCols_ = 0;
+    std::vector<ValueType>().swap(data_);
+    mapped_.reset();
+    begin_ = nullptr;
+  }
+
+  ValueType& operator()(int i, int j) { return begin_[offset(i, j)]; }
+  const ValueType& operator()(int i, int j) const { return begin_[offset(i, j)]; }
+
+  ValueType* column(int j) { return begin_ + offset(0, j); }
+  const ValueType* column(int j) const { return begin_ + offset(0, j); }
+
+  int rows() const { return numRows_; }
+  int cols() const { return numCols_; }
+
+private:
+  using MappedData = std::unique_ptr<ValueType, DPTableUnmap>;
+
+  static MappedData map_file(const std::string& directory, std::size_t bytes) {
+    std::string path = directory + "/dptable.XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0)
+      throw Utils::tableMappingException();
+    unlink(path.c_str());
+    void* data = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+      data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+      throw Utils::tableMappingException();
+    return MappedData(static_cast<ValueType*>(data), DPTableUnmap{bytes});
+  }
+
+  std::size_t offset(int i, int j) const {
+    return static_cast<std::size_t>(j)*static_cast<std::size_t>(numRows_) + static_cast<std::size_t>(i);
+  }
+
+  int numRows_ = 0;
+  int numCols_ = 0;
+  std::vector<ValueType> data_;
+  MappedData mapped_{nullptr, DPTableUnmap{0}};
+  ValueType* begin_ = nullptr;
+};
+
+// Table of next start indices. Entries lie in [0, n], so they are stored
+// in the narrowest unsigned type that holds n.
+class DPIndexTable {
+public:
+  DPIndexTable() = default;
+  DPIndexTable(int numRows, int numCols, const std::string& directory="") { resize(numRows, numCols, directory); }
+
+  void resize(int numRows, int numCols, const std::string& directory="") {
+    isNarrow_ = numRows <= static_cast<int>(std::numeric_limits<std::uint16_t>::max());
+    if (isNarrow_) {
+      narrow_.resize(numRows, numCols, 0, directory);
+      wide_.clear();
+    }
+    else {
+      wide_.resize(numRows, numCols, 0, directory);
+      narrow_.clear();
+    }
+  }
+
+  void clear() {
+    narrow_.clear();
+    wide_.clear();
+  }
+
+  int operator()(int i, int j) const {
+    return isNarrow_ ? static_cast<int>(narrow_(i, j)) : static_cast<int>(wide_(i, j));
+  }
+
+  void set(int i, int j, int k) {
+    if (isNarrow_)
+      narrow_(i, j) = static_cast<std::uint16_t>(k);
+    else
+      wide_(i, j) = static_cast<std::uint32_t>(k);
+  }
+
+  int rows() const { return isNarrow_ ? narrow_.rows() : wide_.rows(); }
+  int cols() const { return isNarrow_ ? narrow_.cols() : wide_.cols(); }
+
+private:
+  bool isNarrow_ = true;
+  DPTable<std::uint16_t> narrow_;
+  DPTable<std::uint32_t> wide_;
+};
+
+// Tables lent to successive solves, so that they reuse one allocation
+template<typename ValueType>
+struct DPWorkspace {
+  DPTable<ValueType> maxScore;
+  DPIndexTable nextStart;
+};
+
+// Swaps a workspace's tables in for the lifetime of the loan, and back on
+// exit, also when the solve throws; a null workspace lends nothing
+template<typename ValueType>
+class DPWorkspaceLoan {
+public:
+  DPWorkspaceLoan(DPWorkspace<ValueType>* workspace, DPTable<ValueType>& maxScore, DPIndexTable& nextStart) :
+    workspace_{workspace},
+    maxScore_{maxScore},
+    nextStart_{nextStart}
+  { swap(); }
+
+  DPWorkspaceLoan(const DPWorkspaceLoan&) = delete;
+  DPWorkspaceLoan& operator=(const DPWorkspaceLoan&) = delete;
+
+  ~DPWorkspaceLoan() { swap(); }
+
+private:
+  void swap() {
+    if (workspace_) {
+      std::swap(maxScore_, workspace_->maxScore);
+      std::swap(nextStart_, workspace_->nextStart);
+    }
+  }
+
+  DPWorkspace<ValueType>* workspace_;
+  DPTable<ValueType>& maxScore_;
+  DPIndexTable& nextStart_;
+};
+
+#endif
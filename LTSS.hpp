@@ -11,15 +11,17 @@
 #include <iostream>
 #include <cmath>
 #include <memory>
+#include <type_traits>
 
 #include "utils.hpp"
 #include "port_utils.hpp"
 #include "score.hpp"
+#include "priority_sort.hpp"
 
 using namespace Utils;
 using namespace Objectives;
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType=RuntimePolicy>
 class LTSSSolver {
 public:
   LTSSSolver(std::vector<DataType> a,
@@ -44,7 +46,7 @@ public:
   { _init(); }
 
   std::vector<int> priority_sortind_;
-  std::vector<int> get_optimal_subset_extern() const;
+  const std::vector<int>& get_optimal_subset_extern() const;
   DataType get_optimal_score_extern() const;
 
 private:
@@ -54,12 +56,20 @@ private:
   DataType optimal_score_;
   std::vector<int> subset_;
   objective_fn parametric_dist_;
-  std::unique_ptr<ParametricContext> context_;
+  std::unique_ptr<ParametricContext<DataType> > context_;
 
-  void _init() { create(); optimize(); }
+  void _init() {
+    if constexpr (!std::is_same<ScorePolicyType, RuntimePolicy>::value) {
+      parametric_dist_ = ScorePolicyType::objective;
+    }
+    create();
+    optimize();
+  }
   void create();
   void createContext();
   void optimize();
+  template<typename ScoreFn>
+  void optimize_scan(const ScoreFn&);
 
   void sort_by_priority(std::vector<DataType>&, std::vector<DataType>&);
   DataType compute_score(int, int);
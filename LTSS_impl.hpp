@@ -1,71 +1,61 @@
 #ifndef __LTSS_IMPL_HPP__
 #define __LTSS_IMPL_HPP__
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 DataType
-LTSSSolver<DataType>::compute_score(int i, int j) {
+LTSSSolver<DataType, ScorePolicyType>::compute_score(int i, int j) {
   return context_->compute_score(i, j);
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 void
-LTSSSolver<DataType>::sort_by_priority(std::vector<DataType>& a, std::vector<DataType>& b) {
-  std::vector<int> ind(a.size());
-  std::iota(ind.begin(), ind.end(), 0);
+LTSSSolver<DataType, ScorePolicyType>::sort_by_priority(std::vector<DataType>& a, std::vector<DataType>& b) {
+  priority_sortind_ = PrioritySort::sort_by_priority(a.data(), b.data(), static_cast<int>(a.size()));
 
-  std::stable_sort(ind.begin(), ind.end(),
-		   [&a, &b](int i, int j) {
-		     return (a[i]/b[i]) < (a[j]/b[j]);
-		   });
-
-  priority_sortind_ = ind;
-
-  // Inefficient reordering
-  std::vector<DataType> a_s, b_s;
-  for (auto i : ind) {
-    a_s.push_back(a[i]);
-    b_s.push_back(b[i]);
+  std::vector<DataType> a_s(a.size()), b_s(b.size());
+  for (std::size_t i=0; i<a.size(); ++i) {
+    a_s[i] = a[priority_sortind_[i]];
+    b_s[i] = b[priority_sortind_[i]];
   }
 
-  std::copy(a_s.begin(), a_s.end(), a.begin());
-  std::copy(b_s.begin(), b_s.end(), b.begin());
-  
+  std::swap(a, a_s);
+  std::swap(b, b_s);
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 void
-LTSSSolver<DataType>::createContext() {
+LTSSSolver<DataType, ScorePolicyType>::createContext() {
   // create reference to score function
-  // always use multiple clustering objective
+  // always use multiple clustering objective, scored from cumulative sums
   if (parametric_dist_ == objective_fn::Gaussian) {
-    context_ = std::make_unique<GaussianContext>(a_, 
-						 b_, 
-						 n_, 
-						 false,
-						 false);
+    context_ = std::make_unique<GaussianContext<DataType> >(a_.data(), 
+							    b_.data(), 
+							    n_, 
+							    false,
+							    true);
   }
   else if (parametric_dist_ == objective_fn::Poisson) {
-    context_ = std::make_unique<PoissonContext>(a_, 
-						b_, 
-						n_,
-						false,
-						false);
+    context_ = std::make_unique<PoissonContext<DataType> >(a_.data(), 
+							   b_.data(), 
+							   n_,
+							   false,
+							   true);
   }
   else if (parametric_dist_ == objective_fn::RationalScore) {
-    context_ = std::make_unique<RationalScoreContext>(a_,
-						      b_,
-						      n_,
-						      false,
-						      false);
+    context_ = std::make_unique<RationalScoreContext<DataType> >(a_.data(),
+								 b_.data(),
+								 n_,
+								 false,
+								 true);
   }
   else {
     throw distributionException();
   }
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 void 
-LTSSSolver<DataType>::create() {
+LTSSSolver<DataType, ScorePolicyType>::create() {
   // sort by priority
   sort_by_priority(a_, b_);
 
@@ -75,16 +65,33 @@ LTSSSolver<DataType>::create() {
   createContext();
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
+void
+LTSSSolver<DataType, ScorePolicyType>::optimize() {
+  // Instantiate the scan for this objective so that the score inlines
+  const double* a_cum = context_->get_a_cum().data();
+  const double* b_cum = context_->get_b_cum().data();
+  if constexpr (!std::is_same<ScorePolicyType, RuntimePolicy>::value) {
+    optimize_scan(CumulativeScore<ScorePolicyType>{a_cum, b_cum});
+  }
+  else {
+    dispatch_score_policy(parametric_dist_, false, a_cum, b_cum, [this](const auto& scorer) {
+	optimize_scan(scorer);
+      });
+  }
+}
+
+template<typename DataType, typename ScorePolicyType>
+template<typename ScoreFn>
 void
-LTSSSolver<DataType>::optimize() {
+LTSSSolver<DataType, ScorePolicyType>::optimize_scan(const ScoreFn& scorer) {
   optimal_score_ = 0.;
 
   DataType maxScore = -std::numeric_limits<DataType>::max();
   std::pair<int, int> p;
   // Test ascending partitions
   for (int i=1; i<=n_; ++i) {
-    auto score = compute_score(0, i);
+    DataType score = scorer(0, i);
     if (score > maxScore) {
       maxScore = score;
       p = std::make_pair(0, i);
@@ -92,7 +99,7 @@ LTSSSolver<DataType>::optimize() {
   }
   // Test descending partitions
   for (int i=n_-1; i>=0; --i) {
-    auto score = compute_score(i, n_);
+    DataType score = scorer(i, n_);
     if (score > maxScore) {
       maxScore = score;
       p = std::make_pair(i, n_);
@@ -105,15 +112,15 @@ LTSSSolver<DataType>::optimize() {
   optimal_score_ = maxScore;
 }
 
-template<typename DataType>
-std::vector<int>
-LTSSSolver<DataType>::get_optimal_subset_extern() const {
+template<typename DataType, typename ScorePolicyType>
+const std::vector<int>&
+LTSSSolver<DataType, ScorePolicyType>::get_optimal_subset_extern() const {
   return subset_;
 }
 
-template<typename DataType>
+template<typename DataType, typename ScorePolicyType>
 DataType
-LTSSSolver<DataType>::get_optimal_score_extern() const {
+LTSSSolver<DataType, ScorePolicyType>::get_optimal_score_extern() const {
   return optimal_score_;
 }
 
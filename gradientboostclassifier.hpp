@@ -77,6 +77,19 @@ namespace ClassifierContext {
     lossFunction loss;
     std::size_t partitionSize;
     double partitionRatio = .5;
+    // 0 solves the partition exactly, otherwise over at most this many
+    // quantile bins of the priority-sorted samples
+    std::size_t partitionBins = 0;
+    // 0 solves each step from scratch, otherwise the partition search is
+    // warm started within this many positions of the previous boundaries
+    // for the same number of subsets; faster, but may miss the optimum
+    std::size_t partitionWarmStartBand = 0;
+    // 0 solves the partition over all samples, otherwise over a random
+    // subsample of this many, and assigns the rest by g/h thresholds
+    std::size_t partitionSubsampleSize = 0;
+    // 0 always solves the partition with the DP, otherwise steps with at
+    // least this many subsets use the greedy top-down splitter instead
+    std::size_t partitionGreedyMinSize = 0;
     double learningRate;
     int steps;
     bool symmetrizeLabels;
@@ -87,6 +100,10 @@ namespace ClassifierContext {
     PartitionSize::SizeMethod partitionSizeMethod;
     LearningRate::RateMethod learningRateMethod;
     std::size_t minLeafSize;
+    // Bounds on the number of samples in each block of the partition, 0
+    // for none; relaxed to the nearest feasible ones for small datasets
+    std::size_t minPartitionBlockSize = 0;
+    std::size_t maxPartitionBlockSize = 0;
     double minimumGainSplit;
     std::size_t maxDepth;
     std::size_t numTrees;
@@ -349,6 +366,10 @@ public:
     loss_{context.loss},
     partitionSize_{context.partitionSize},
     partitionRatio_{context.partitionRatio},
+    partitionBins_{context.partitionBins},
+    partitionWarmStartBand_{context.partitionWarmStartBand},
+    partitionSubsampleSize_{context.partitionSubsampleSize},
+    partitionGreedyMinSize_{context.partitionGreedyMinSize},
     learningRate_{context.learningRate},
     steps_{context.steps},
     symmetrized_{context.symmetrizeLabels},
@@ -359,6 +380,8 @@ public:
     partitionSizeMethod_{context.partitionSizeMethod},
     learningRateMethod_{context.learningRateMethod},
     minLeafSize_{context.minLeafSize},
+    minPartitionBlockSize_{context.minPartitionBlockSize},
+    maxPartitionBlockSize_{context.maxPartitionBlockSize},
     minimumGainSplit_{context.minimumGainSplit},
     maxDepth_{context.maxDepth},
     numTrees_{context.numTrees},
@@ -383,6 +406,10 @@ public:
     loss_{context.loss},
     partitionSize_{context.partitionSize},
     partitionRatio_{context.partitionRatio},
+    partitionBins_{context.partitionBins},
+    partitionWarmStartBand_{context.partitionWarmStartBand},
+    partitionSubsampleSize_{context.partitionSubsampleSize},
+    partitionGreedyMinSize_{context.partitionGreedyMinSize},
     learningRate_{context.learningRate},
     steps_{context.steps},
     symmetrized_{context.symmetrizeLabels},
@@ -393,6 +420,8 @@ public:
     partitionSizeMethod_{context.partitionSizeMethod},
     learningRateMethod_{context.learningRateMethod},
     minLeafSize_{context.minLeafSize},
+    minPartitionBlockSize_{context.minPartitionBlockSize},
+    maxPartitionBlockSize_{context.maxPartitionBlockSize},
     minimumGainSplit_{context.minimumGainSplit},
     maxDepth_{context.maxDepth},
     numTrees_{context.numTrees},
@@ -454,6 +483,8 @@ private:
   std::pair<rowvec,rowvec> generate_coefficients(const Row<DataType>&, const uvec&);
   std::pair<rowvec,rowvec> generate_coefficients(const Row<DataType>&, const Row<DataType>&, const uvec&);
   Leaves computeOptimalSplit(rowvec&, rowvec&, mat, std::size_t, std::size_t, const uvec&);
+  void extendSubsamplePartition(const rowvec&, const rowvec&, const rowvec&, const rowvec&,
+				const std::vector<int>&, const std::vector<int>&, rowvec&);
 
   void setNextClassifier(const ClassifierType&);
   int steps_;
@@ -463,6 +494,10 @@ private:
   Row<double> labels_oos_;
   std::size_t partitionSize_;
   double partitionRatio_;
+  std::size_t partitionBins_;
+  std::size_t partitionWarmStartBand_;
+  std::size_t partitionSubsampleSize_;
+  std::size_t partitionGreedyMinSize_;
   Row<DataType> latestPrediction_;
 
   lossFunction loss_;
@@ -485,12 +520,16 @@ private:
   double b_;
 
   std::size_t minLeafSize_;
+  std::size_t minPartitionBlockSize_;
+  std::size_t maxPartitionBlockSize_;
   double minimumGainSplit_;
   std::size_t maxDepth_;
   std::size_t numTrees_;
 
   ClassifierList classifiers_;
   PartitionList partitions_;
+  // priority order of the last split, a sort hint for the next one
+  std::vector<int> prioritySortHint_;
   PredictionList predictions_;
   MaskList colMasks_;
 
@@ -383,6 +383,10 @@ GradientBoostClassifier<ClassifierType>::fit_step(std::size_t stepNum) {
     context.loss = lossFunction::MSE;
     context.partitionSize = subPartitionSize + 1;
     context.partitionRatio = partitionRatio_;
+    context.partitionBins = partitionBins_;
+    context.partitionWarmStartBand = partitionWarmStartBand_;
+    context.partitionSubsampleSize = partitionSubsampleSize_;
+    context.partitionGreedyMinSize = partitionGreedyMinSize_;
     // context.learningRate = learningRate_;
     context.learningRate = std::min(1., 2.*learningRate_);
     context.steps = std::log(subPartitionSize);
@@ -398,6 +402,8 @@ GradientBoostClassifier<ClassifierType>::fit_step(std::size_t stepNum) {
     context.partitionSizeMethod = partitionSizeMethod_;
     context.learningRateMethod = learningRateMethod_;    
     context.minLeafSize = minLeafSize_;
+    context.minPartitionBlockSize = minPartitionBlockSize_;
+    context.maxPartitionBlockSize = maxPartitionBlockSize_;
     context.maxDepth = maxDepth_;
     context.minimumGainSplit = minimumGainSplit_;
     
@@ -453,9 +459,6 @@ GradientBoostClassifier<ClassifierType>::computeOptimalSplit(rowvec& g,
 
   // We should implement several methods here
   // XXX
-  std::vector<double> gv = arma::conv_to<std::vector<double>>::from(g);
-  std::vector<double> hv = arma::conv_to<std::vector<double>>::from(h);
-
   int n = colMask.n_rows, T = partitionSize;
   bool risk_partitioning_objective = true;
   bool use_rational_optimization = true;
@@ -466,33 +469,138 @@ GradientBoostClassifier<ClassifierType>::computeOptimalSplit(rowvec& g,
 
   // std::cout << "PARTITION SIZE: " << T << std::endl;
 
-  auto dp = DPSolver(n, T, gv, hv,
+  // Optionally solve over a random subsample of m samples; as blocks are
+  // intervals of g/h, the partition then extends to all n by thresholds
+  int m = n;
+  rowvec gSub, hSub;
+  if ((partitionSubsampleSize_ >= static_cast<std::size_t>(T)) && (partitionSubsampleSize_ < static_cast<std::size_t>(n))) {
+    m = static_cast<int>(partitionSubsampleSize_);
+    std::vector<int> ind(n), sample(m);
+    std::iota(ind.begin(), ind.end(), 0);
+    std::sample(ind.cbegin(), ind.cend(), sample.begin(), m, mersenne_engine_);
+    gSub.set_size(m);
+    hSub.set_size(m);
+    for (int i=0; i<m; ++i) {
+      gSub(i) = g(sample[i]);
+      hSub(i) = h(sample[i]);
+    }
+  }
+  bool subsampled = (m < n);
+
+  DPSolverContext::Context dpContext{};
+  if (partitionBins_ > 0) {
+    dpContext.engine = EngineMethod::Binned;
+    dpContext.numBins = static_cast<int>(partitionBins_);
+  }
+  if ((partitionGreedyMinSize_ > 0) && (partitionSize >= partitionGreedyMinSize_))
+    dpContext.engine = EngineMethod::Greedy;
+
+  // Risk partitioning subsets are in priority order, so the previous
+  // boundaries are the running sums of the subset sizes. Recursive fits
+  // alternate partition sizes, so the last one of this size is used
+  auto previous = std::find_if(partitions_.crbegin(), partitions_.crend(),
+			       [partitionSize](const Partition& partition) { return partition.size() == partitionSize; });
+  if ((partitionWarmStartBand_ > 0) && !subsampled && (previous != partitions_.crend())) {
+    std::vector<int> warmStart{0};
+    for (const auto& subset : *previous)
+      warmStart.push_back(warmStart.back() + static_cast<int>(subset.size()));
+    if (warmStart.back() == n) {
+      dpContext.warmStart = warmStart;
+      dpContext.warmStartBand = static_cast<int>(partitionWarmStartBand_);
+    }
+  }
+
+  // Block size bounds, scaled to the subsample and relaxed to an even
+  // split if m can't meet them
+  if ((minPartitionBlockSize_ > 0) || (maxPartitionBlockSize_ > 0)) {
+    std::size_t minBlock = std::min(minPartitionBlockSize_*m/n, static_cast<std::size_t>(m/T));
+    std::size_t maxBlock = (maxPartitionBlockSize_*m + n - 1)/n;
+    if ((maxBlock > 0) && (maxBlock*T < static_cast<std::size_t>(m)))
+      maxBlock = (m + T - 1)/T;
+    dpContext.minSegmentLength = static_cast<int>(std::max<std::size_t>(1, minBlock));
+    dpContext.maxSegmentLength = static_cast<int>(maxBlock);
+  }
+
+  // g/h ratios move little between steps, so the last order is a
+  // cheap starting point for the sort
+  if (!subsampled && (prioritySortHint_.size() == static_cast<std::size_t>(n)))
+    dpContext.sortHint = std::move(prioritySortHint_);
+
+  // The solver reads g, h in place
+  auto dp = DPSolver(m, T,
+		     subsampled ? gSub.memptr() : g.memptr(),
+		     subsampled ? hSub.memptr() : h.memptr(),
 		     objective_fn::RationalScore,
 		     risk_partitioning_objective,
 		     use_rational_optimization,
 		     gamma,
 		     reg_power,
 		     sweep_down,
-		     find_optimal_t
+		     find_optimal_t,
+		     dpContext
 		     );
   
-  auto subsets = dp.get_optimal_subsets_extern();
-  
-  rowvec leaf_values = arma::zeros<rowvec>(n);
-  for (const auto& subset : subsets) {
-    uvec ind = arma::conv_to<uvec>::from(subset);
-    double val = -1. * learningRate_ * sum(g(ind))/sum(h(ind));
-    for (auto i: ind) {
-       leaf_values(i) = val;
+  rowvec leaf_values = zeros<rowvec>(n);
+
+  if (subsampled) {
+    std::vector<int>().swap(prioritySortHint_);
+    extendSubsamplePartition(g, h, gSub, hSub, dp.get_priority_sortind_extern(), dp.get_optimal_boundaries_extern(), leaf_values);
+    return leaf_values;
+  }
+
+  prioritySortHint_ = dp.get_priority_sortind_extern();
+
+  // Blocks are ranges of the priority order, and the solver has their
+  // g, h sums
+  const auto& sortind = dp.get_priority_sortind_extern();
+  const auto& boundaries = dp.get_optimal_boundaries_extern();
+  const auto& gSums = dp.get_block_a_sums_extern();
+  const auto& hSums = dp.get_block_b_sums_extern();
+
+  for (std::size_t s=0; s<gSums.size(); ++s) {
+    double val = -1. * learningRate_ * gSums[s]/hSums[s];
+    for (int i=boundaries[s]; i<boundaries[s+1]; ++i) {
+      leaf_values(sortind[i]) = val;
     }
   }
 
-  partitions_.emplace_back(subsets);
+  partitions_.emplace_back(dp.get_optimal_subsets_extern());
 
   return leaf_values;
     
 }
 
+template<typename ClassifierType>
+void
+GradientBoostClassifier<ClassifierType>::extendSubsamplePartition(const rowvec& g,
+								  const rowvec& h,
+								  const rowvec& gSub,
+								  const rowvec& hSub,
+								  const std::vector<int>& sortind,
+								  const std::vector<int>& boundaries,
+								  rowvec& leaf_values) {
+  // Blocks are intervals of g/h, so each of the n samples goes to the
+  // block of the subsample whose ratio range holds its own
+  int n = static_cast<int>(g.n_elem), T = static_cast<int>(boundaries.size()) - 1;
+  std::vector<int> block = PrioritySort::extend_blocks(g.memptr(), h.memptr(), n,
+						       gSub.memptr(), hSub.memptr(),
+						       sortind, boundaries);
+
+  std::vector<double> gSums(T, 0.), hSums(T, 0.);
+  Partition partition(T);
+  for (int i=0; i<n; ++i) {
+    gSums[block[i]] += g(i);
+    hSums[block[i]] += h(i);
+    partition[block[i]].push_back(i);
+  }
+
+  for (int i=0; i<n; ++i) {
+    leaf_values(i) = -1. * learningRate_ * gSums[block[i]]/hSums[block[i]];
+  }
+
+  partitions_.emplace_back(std::move(partition));
+}
+
 template<typename ClassifierType>
 void
 GradientBoostClassifier<ClassifierType>::purge() {
@@ -502,6 +610,7 @@ GradientBoostClassifier<ClassifierType>::purge() {
   labels_oos_ = ones<Row<double>>(0);
   std::vector<Partition>().swap(partitions_);
   std::vector<uvec>().swap(colMasks_);
+  std::vector<int>().swap(prioritySortHint_);
 
   // dataset_.clear();
   // labels_.clear();
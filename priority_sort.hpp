@@ -0,0 +1,204 @@
+#ifndef __PRIORITY_SORT_HPP__
+#define __PRIORITY_SORT_HPP__
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Stable sort of indices by the priority function G(x,y) = x/y, shared by
+// DPSolver and LTSSSolver. Each ratio is computed once and mapped to an
+// unsigned key with the same order, and the keys are sorted by an LSD
+// radix sort. Every pass histograms and scatters contiguous blocks of the
+// input in parallel; blocks scatter in order within each digit, so the
+// sort is stable and equal ratios keep their input order, as with
+// std::stable_sort on a[i]/b[i] < a[j]/b[j].
+namespace PrioritySort {
+
+  constexpr int RADIX_BITS = 11;
+  constexpr int RADIX_BUCKETS = 1 << RADIX_BITS;
+  constexpr int KEY_BITS = 64;
+  // Smaller inputs, and blocks smaller than this, aren't worth the passes
+  constexpr int RADIX_MIN_SIZE = 4096;
+
+  // Order-preserving map of a double to an unsigned key; -0 and +0 compare
+  // equal, so they map to the same key
+  inline std::uint64_t ratio_key(double ratio) {
+    if (ratio == 0.)
+      ratio = 0.;
+    std::uint64_t bits;
+    std::memcpy(&bits, &ratio, sizeof(bits));
+    return (bits >> 63) ? ~bits : (bits | (std::uint64_t{1} << 63));
+  }
+
+  template<typename DataType>
+  std::vector<std::uint64_t> ratio_keys(const DataType* a, const DataType* b, int n, int numThreads) {
+    std::vector<std::uint64_t> keys(n);
+#pragma omp parallel for schedule(static) num_threads(numThreads) if(numThreads > 1)
+    for (int i=0; i<n; ++i) {
+      keys[i] = ratio_key(static_cast<double>(a[i]/b[i]));
+    }
+    return keys;
+  }
+
+  // Stable sort of [0, n) by keys; consumes keys
+  inline std::vector<int> sort_by_key(std::vector<std::uint64_t>& keys, int numThreads) {
+    int n = static_cast<int>(keys.size());
+    std::vector<int> ind(n);
+    std::iota(ind.begin(), ind.end(), 0);
+
+    if (n < RADIX_MIN_SIZE) {
+      std::stable_sort(ind.begin(), ind.end(),
+		       [&keys](int i, int j) {
+			 return keys[i] < keys[j];
+		       });
+      return ind;
+    }
+
+    int numBlocks = std::max(1, std::min(numThreads, n/RADIX_MIN_SIZE));
+    auto block_first = [n, numBlocks](int block) {
+      return static_cast<int>((static_cast<long long>(block) * n) / numBlocks);
+    };
+
+    std::vector<std::uint64_t> keysBuf(n);
+    std::vector<int> indBuf(n);
+    // counts[block*RADIX_BUCKETS + digit], then the scatter positions
+    std::vector<std::size_t> counts(static_cast<std::size_t>(numBlocks)*RADIX_BUCKETS);
+
+    for (int shift=0; shift<KEY_BITS; shift+=RADIX_BITS) {
+      std::fill(counts.begin(), counts.end(), 0);
+#pragma omp parallel for schedule(static, 1) num_threads(numBlocks) if(numBlocks > 1)
+      for (int block=0; block<numBlocks; ++block) {
+	std::size_t* blockCounts = counts.data() + static_cast<std::size_t>(block)*RADIX_BUCKETS;
+	for (int i=block_first(block); i<block_first(block+1); ++i) {
+	  ++blockCounts[(keys[i] >> shift) & (RADIX_BUCKETS-1)];
+	}
+      }
+
+      // Digit-major, block-minor offsets; a pass where every key has the
+      // same digit leaves the order unchanged
+      bool trivialPass = false;
+      std::size_t offset = 0;
+      for (int digit=0; digit<RADIX_BUCKETS; ++digit) {
+	std::size_t digitCount = 0;
+	for (int block=0; block<numBlocks; ++block) {
+	  std::size_t& count = counts[static_cast<std::size_t>(block)*RADIX_BUCKETS + digit];
+	  digitCount += count;
+	  std::size_t position = offset;
+	  offset += count;
+	  count = position;
+	}
+	trivialPass = trivialPass || (digitCount == static_cast<std::size_t>(n));
+      }
+      if (trivialPass)
+	continue;
+
+#pragma omp parallel for schedule(static, 1) num_threads(numBlocks) if(numBlocks > 1)
+      for (int block=0; block<numBlocks; ++block) {
+	std::size_t* positions = counts.data() + static_cast<std::size_t>(block)*RADIX_BUCKETS;
+	for (int i=block_first(block); i<block_first(block+1); ++i) {
+	  std::size_t position = positions[(keys[i] >> shift) & (RADIX_BUCKETS-1)]++;
+	  keysBuf[position] = keys[i];
+	  indBuf[position] = ind[i];
+	}
+      }
+      std::swap(keys, keysBuf);
+      std::swap(ind, indBuf);
+    }
+
+    return ind;
+  }
+
+  template<typename DataType>
+  std::vector<int> sort_by_priority(const DataType* a, const DataType* b, int n, int numThreads=1) {
+    std::vector<std::uint64_t> keys = ratio_keys(a, b, n, numThreads);
+    return sort_by_key(keys, numThreads);
+  }
+
+  // Adaptive variant for inputs close to a known order: hint is a
+  // permutation of [0, n), typically the previous call's result. Walking
+  // the hint, an index that breaks the sorted order is set aside together
+  // with the last kept index, which leaves a sorted subsequence and at
+  // most twice the minimum number of displaced indices. Those are sorted
+  // and merged back in, in O(n + m log m) for m displaced indices. Ties
+  // break on the index, so the result is the same as without the hint.
+  // Falls back to the radix sort when the hint isn't a permutation or
+  // more than n/16 indices are displaced, where the radix sort is faster.
+  template<typename DataType>
+  std::vector<int> sort_by_priority(const DataType* a,
+				    const DataType* b,
+				    int n,
+				    const std::vector<int>& hint,
+				    int numThreads=1) {
+    if (static_cast<int>(hint.size()) != n)
+      return sort_by_priority(a, b, n, numThreads);
+
+    std::vector<char> seen(n, 0);
+    for (int i : hint) {
+      if ((i < 0) || (i >= n) || seen[i])
+	return sort_by_priority(a, b, n, numThreads);
+      seen[i] = 1;
+    }
+
+    std::vector<std::uint64_t> keys = ratio_keys(a, b, n, numThreads);
+    auto precedes = [&keys](int i, int j) {
+      return (keys[i] < keys[j]) || ((keys[i] == keys[j]) && (i < j));
+    };
+
+    std::vector<int> kept, displaced;
+    kept.reserve(n);
+    for (int i : hint) {
+      if (!kept.empty() && precedes(i, kept.back())) {
+	displaced.push_back(kept.back());
+	displaced.push_back(i);
+	kept.pop_back();
+	if (static_cast<int>(displaced.size()) > (n/16))
+	  return sort_by_key(keys, numThreads);
+      }
+      else {
+	kept.push_back(i);
+      }
+    }
+
+    std::sort(displaced.begin(), displaced.end(), precedes);
+    std::vector<int> ind(n);
+    std::merge(kept.cbegin(), kept.cend(), displaced.cbegin(), displaced.cend(), ind.begin(), precedes);
+    return ind;
+  }
+
+  // Extends a partition of a subsample aSub, bSub to the n points a, b.
+  // Block s of the subsample, [boundaries[s], boundaries[s+1]) of its
+  // priority order sortind, starts at the key of its first point, and
+  // each point goes to the last block starting at or below its key, by
+  // binary search on the T-1 start keys. On the subsample itself this
+  // gives back its partition, unless a boundary splits equal ratios
+  template<typename DataType>
+  std::vector<int> extend_blocks(const DataType* a,
+				 const DataType* b,
+				 int n,
+				 const DataType* aSub,
+				 const DataType* bSub,
+				 const std::vector<int>& sortind,
+				 const std::vector<int>& boundaries,
+				 int numThreads=1) {
+    int T = static_cast<int>(boundaries.size()) - 1;
+    std::vector<std::uint64_t> thresholds(std::max(T-1, 0));
+    for (int s=1; s<T; ++s) {
+      int i = sortind[boundaries[s]];
+      thresholds[s-1] = ratio_key(static_cast<double>(aSub[i]/bSub[i]));
+    }
+
+    std::vector<int> block(n);
+#pragma omp parallel for schedule(static) num_threads(numThreads) if(numThreads > 1)
+    for (int i=0; i<n; ++i) {
+      std::uint64_t key = ratio_key(static_cast<double>(a[i]/b[i]));
+      block[i] = static_cast<int>(std::upper_bound(thresholds.cbegin(), thresholds.cend(), key) - thresholds.cbegin());
+    }
+    return block;
+  }
+
+} // namespace PrioritySort
+
+#endif
@@ -11,6 +11,7 @@
 #include <cmath>
 #include <exception>
 
+#include "utils.hpp"
 
 #define UNUSED(expr) do { (void)(expr); } while (0)
 
@@ -25,21 +26,113 @@ namespace Objectives {
    };
   };
 
+  // Statically known score of a subset as a function of its sums
+  // C = sum(a), B = sum(b), one per (objective, risk partitioning) pair.
+  // The contexts below use the same formulas through their virtual
+  // interface.
+  template<objective_fn Objective, bool RiskPartitioning>
+  struct ScorePolicy;
+
+  template<>
+  struct ScorePolicy<objective_fn::Gaussian, true> {
+    static constexpr objective_fn objective = objective_fn::Gaussian;
+    static constexpr bool risk_partitioning_objective = true;
+    static double score(double C, double B) { return C*C/2./B; }
+  };
+
+  template<>
+  struct ScorePolicy<objective_fn::Gaussian, false> {
+    static constexpr objective_fn objective = objective_fn::Gaussian;
+    static constexpr bool risk_partitioning_objective = false;
+    static double score(double C, double B) { return (C>B)? .5*(std::pow(C,2)/B + B) - C : 0.; }
+  };
+
+  template<>
+  struct ScorePolicy<objective_fn::Poisson, true> {
+    static constexpr objective_fn objective = objective_fn::Poisson;
+    static constexpr bool risk_partitioning_objective = true;
+    static double score(double C, double B) { return C*std::log(C/B); }
+  };
+
+  template<>
+  struct ScorePolicy<objective_fn::Poisson, false> {
+    static constexpr objective_fn objective = objective_fn::Poisson;
+    static constexpr bool risk_partitioning_objective = false;
+    static double score(double C, double B) { return (C>B)? C*std::log(C/B) + B - C : 0.; }
+  };
 
+  template<bool RiskPartitioning>
+  struct ScorePolicy<objective_fn::RationalScore, RiskPartitioning> {
+    static constexpr objective_fn objective = objective_fn::RationalScore;
+    static constexpr bool risk_partitioning_objective = RiskPartitioning;
+    static double score(double C, double B) { return C*C/B; }
+  };
+
+  // Tag for solvers that choose the objective at runtime
+  struct RuntimePolicy {};
+
+  // Range score over [i, j) from cumulative sums, fully inlined
+  template<typename ScorePolicyType>
+  struct CumulativeScore {
+    using policy = ScorePolicyType;
+    const double* a_cum;
+    const double* b_cum;
+    double operator()(int i, int j) const {
+      return ScorePolicyType::score(a_cum[j] - a_cum[i], b_cum[j] - b_cum[i]);
+    }
+  };
+
+  // Instantiates fn on the CumulativeScore matching the runtime flags
+  template<typename Fn>
+  void dispatch_score_policy(objective_fn parametric_dist,
+			     bool risk_partitioning_objective,
+			     const double* a_cum,
+			     const double* b_cum,
+			     Fn&& fn) {
+    if (parametric_dist == objective_fn::Gaussian) {
+      if (risk_partitioning_objective)
+	fn(CumulativeScore<ScorePolicy<objective_fn::Gaussian, true> >{a_cum, b_cum});
+      else
+	fn(CumulativeScore<ScorePolicy<objective_fn::Gaussian, false> >{a_cum, b_cum});
+    }
+    else if (parametric_dist == objective_fn::Poisson) {
+      if (risk_partitioning_objective)
+	fn(CumulativeScore<ScorePolicy<objective_fn::Poisson, true> >{a_cum, b_cum});
+      else
+	fn(CumulativeScore<ScorePolicy<objective_fn::Poisson, false> >{a_cum, b_cum});
+    }
+    else if (parametric_dist == objective_fn::RationalScore) {
+      if (risk_partitioning_objective)
+	fn(CumulativeScore<ScorePolicy<objective_fn::RationalScore, true> >{a_cum, b_cum});
+      else
+	fn(CumulativeScore<ScorePolicy<objective_fn::RationalScore, false> >{a_cum, b_cum});
+    }
+    else {
+      throw Utils::distributionException();
+    }
+  }
+
+
+  // Data is DataType, sums and scores are double, so a float solver keeps
+  // double-precision cumulative sums
+  template<typename DataType>
   class ParametricContext {
   protected:
-    std::vector<double> a_;
-    std::vector<double> b_;
+    // Not owned; the caller keeps the sorted data alive for the lifetime
+    // of the context
+    const DataType* a_;
+    const DataType* b_;
     int n_;
-    std::vector<std::vector<double> > a_sums_;
-    std::vector<std::vector<double> > b_sums_;
+    // cumulative sums, a_cum_[j] - a_cum_[i] = sum(a_[i:j])
+    std::vector<double> a_cum_;
+    std::vector<double> b_cum_;
     bool risk_partitioning_objective_;
     bool use_rational_optimization_;
     std::string name_;
 
   public:
-    ParametricContext(std::vector<double> a, 
-		      std::vector<double> b, 
+    ParametricContext(const DataType* a, 
+		      const DataType* b, 
 		      int n, 
 		      bool risk_partitioning_objective,
 		      bool use_rational_optimization,
@@ -56,7 +149,14 @@ namespace Objectives {
 
     virtual ~ParametricContext() = default;
 
-    virtual void compute_partial_sums() {};
+    virtual void compute_partial_sums() {
+      a_cum_ = std::vector<double>(n_+1, 0.);
+      b_cum_ = std::vector<double>(n_+1, 0.);
+      for (int i=0; i<n_; ++i) {
+	a_cum_[i+1] = a_cum_[i] + a_[i];
+	b_cum_[i+1] = b_cum_[i] + b_[i];
+      }
+    }
 
     virtual double compute_score_multclust(int, int) = 0;
     virtual double compute_score_multclust_optimized(int, int) = 0;
@@ -66,6 +166,9 @@ namespace Objectives {
     virtual double compute_ambient_score_multclust(double, double) = 0;
     virtual double compute_ambient_score_riskpart(double, double) = 0;
 
+    const std::vector<double>& get_a_cum() const { return a_cum_; }
+    const std::vector<double>& get_b_cum() const { return b_cum_; }
+
     std::string getName() const { return name_; }
     bool getRiskPartitioningObjective() const { return risk_partitioning_objective_; }
     bool getUseRationalOptimization() const { return use_rational_optimization_; }
@@ -99,191 +202,151 @@ namespace Objectives {
     }
   };
   
-  class PoissonContext : public ParametricContext {
+  template<typename DataType>
+  class PoissonContext : public ParametricContext<DataType> {
+
+  protected:
+    using ParametricContext<DataType>::a_;
+    using ParametricContext<DataType>::b_;
+    using ParametricContext<DataType>::a_cum_;
+    using ParametricContext<DataType>::b_cum_;
+    using ParametricContext<DataType>::compute_partial_sums;
 
   public:
-    PoissonContext(std::vector<double> a, 
-		   std::vector<double> b, 
+    PoissonContext(const DataType* a, 
+		   const DataType* b, 
 		   int n, 
 		   bool risk_partitioning_objective,
-		   bool use_rational_optimization) : ParametricContext(a,
-								       b,
-								       n,
-								       risk_partitioning_objective,
-								       use_rational_optimization,
-								       "Poisson")
+		   bool use_rational_optimization) : ParametricContext<DataType>(a,
+										 b,
+										 n,
+										 risk_partitioning_objective,
+										 use_rational_optimization,
+										 "Poisson")
     { if (use_rational_optimization) {
 	compute_partial_sums();
       }
     }
   
     double compute_score_multclust(int i, int j) override {    
-      double C = std::accumulate(a_.cbegin()+i, a_.cbegin()+j, 0.);
-      double B = std::accumulate(b_.cbegin()+i, b_.cbegin()+j, 0.);
-      return (C>B)? C*std::log(C/B) + B - C : 0.;
+      double C = std::accumulate(a_+i, a_+j, 0.);
+      double B = std::accumulate(b_+i, b_+j, 0.);
+      return ScorePolicy<objective_fn::Poisson, false>::score(C, B);
     }
 
     double compute_score_riskpart(int i, int j) override {
-      double C = std::accumulate(a_.cbegin()+i, a_.cbegin()+j, 0.);
-      double B = std::accumulate(b_.cbegin()+i, b_.cbegin()+j, 0.);
-      return C*std::log(C/B);
+      double C = std::accumulate(a_+i, a_+j, 0.);
+      double B = std::accumulate(b_+i, b_+j, 0.);
+      return ScorePolicy<objective_fn::Poisson, true>::score(C, B);
     }
     
     double compute_ambient_score_multclust(double a, double b) override {
-      return (a>b)? a*std::log(a/b) + b - a : 0.;
+      return ScorePolicy<objective_fn::Poisson, false>::score(a, b);
     }
 
     double compute_ambient_score_riskpart(double a, double b) override {
-      return a*std::log(a/b);
+      return ScorePolicy<objective_fn::Poisson, true>::score(a, b);
     }  
 
-    void compute_partial_sums() override {
-      double a_cum;
-      a_sums_ = std::vector<std::vector<double> >(n_, std::vector<double>(n_+1, std::numeric_limits<double>::lowest()));
-      b_sums_ = std::vector<std::vector<double> >(n_, std::vector<double>(n_+1, std::numeric_limits<double>::lowest()));
-    
-      for (int i=0; i<n_; ++i) {
-	a_sums_[i][i] = 0.;
-	b_sums_[i][i] = 0.;
-      }
-
-      for (int i=0; i<n_; ++i) {
-	a_cum = -a_[i-1];
-	for (int j=i+1; j<=n_; ++j) {
-	  a_cum += a_[j-2];
-	  a_sums_[i][j] = a_sums_[i][j-1] + a_[j-1];
-	  b_sums_[i][j] = b_sums_[i][j-1] + b_[j-1];
-	}
-      }  
-    }
-
     double compute_score_riskpart_optimized(int i, int j) override {
-      double score = a_sums_[i][j]*std::log(a_sums_[i][j]/b_sums_[i][j]);
-      return score;
+      return ScorePolicy<objective_fn::Poisson, true>::score(a_cum_[j] - a_cum_[i], b_cum_[j] - b_cum_[i]);
     }
     
     double compute_score_multclust_optimized(int i, int j) override {
-      double score = (a_sums_[i][j] > b_sums_[i][j]) ? a_sums_[i][j]*std::log(a_sums_[i][j]/b_sums_[i][j]) + b_sums_[i][j] - a_sums_[i][j]: 0.;
-      return score;
+      return ScorePolicy<objective_fn::Poisson, false>::score(a_cum_[j] - a_cum_[i], b_cum_[j] - b_cum_[i]);
     }
     
   };
 
-  class GaussianContext : public ParametricContext {
+  template<typename DataType>
+  class GaussianContext : public ParametricContext<DataType> {
+
+  protected:
+    using ParametricContext<DataType>::a_;
+    using ParametricContext<DataType>::b_;
+    using ParametricContext<DataType>::a_cum_;
+    using ParametricContext<DataType>::b_cum_;
+    using ParametricContext<DataType>::compute_partial_sums;
 
   public:
-    GaussianContext(std::vector<double> a, 
-		    std::vector<double> b, 
+    GaussianContext(const DataType* a, 
+		    const DataType* b, 
 		    int n, 
 		    bool risk_partitioning_objective,
-		    bool use_rational_optimization) : ParametricContext(a,
-									b,
-									n,
-									risk_partitioning_objective,
-									use_rational_optimization,
-									"Gaussian")
+		    bool use_rational_optimization) : ParametricContext<DataType>(a,
+										  b,
+										  n,
+										  risk_partitioning_objective,
+										  use_rational_optimization,
+										  "Gaussian")
     { if (use_rational_optimization) {
 	compute_partial_sums();
       }
     }
   
     double compute_score_multclust(int i, int j) override {
-      double C = std::accumulate(a_.cbegin()+i, a_.cbegin()+j, 0.);
-      double B = std::accumulate(b_.cbegin()+i, b_.cbegin()+j, 0.);
-      return (C>B)? .5*(std::pow(C,2)/B + B) - C : 0.;
+      double C = std::accumulate(a_+i, a_+j, 0.);
+      double B = std::accumulate(b_+i, b_+j, 0.);
+      return ScorePolicy<objective_fn::Gaussian, false>::score(C, B);
     }
   
     double compute_score_riskpart(int i, int j) override {
-      double C = std::accumulate(a_.cbegin()+i, a_.cbegin()+j, 0.);
-      double B = std::accumulate(b_.cbegin()+i, b_.cbegin()+j, 0.);
-      return C*C/2./B;
+      double C = std::accumulate(a_+i, a_+j, 0.);
+      double B = std::accumulate(b_+i, b_+j, 0.);
+      return ScorePolicy<objective_fn::Gaussian, true>::score(C, B);
     }
 
     double compute_ambient_score_multclust(double a, double b) override {
-      return (a>b)? .5*(std::pow(a,2)/b + b) - a : 0.;
+      return ScorePolicy<objective_fn::Gaussian, false>::score(a, b);
     }
 
     double compute_ambient_score_riskpart(double a, double b) override {
-      return a*a/2./b;
-    }
-
-    void compute_partial_sums() override {
-      double a_cum;
-      a_sums_ = std::vector<std::vector<double> >(n_, std::vector<double>(n_+1, std::numeric_limits<double>::lowest()));
-      b_sums_ = std::vector<std::vector<double> >(n_, std::vector<double>(n_+1, std::numeric_limits<double>::lowest()));
-    
-      for (int i=0; i<n_; ++i) {
-	a_sums_[i][i] = 0.;
-	b_sums_[i][i] = 0.;
-      }
-
-      for (int i=0; i<n_; ++i) {
-	a_cum = -a_[i-1];
-	for (int j=i+1; j<=n_; ++j) {
-	  a_cum += a_[j-2];
-	  a_sums_[i][j] = a_sums_[i][j-1] + a_[j-1];
-	  b_sums_[i][j] = b_sums_[i][j-1] + b_[j-1];
-	}
-      }  
+      return ScorePolicy<objective_fn::Gaussian, true>::score(a, b);
     }
 
     double compute_score_multclust_optimized(int i, int j) override {
-      double score = (a_sums_[i][j] > b_sums_[i][j]) ? .5*(std::pow(a_sums_[i][j], 2)/b_sums_[i][j] + b_sums_[i][j]) - a_sums_[i][j] : 0.;
-      return score;
+      return ScorePolicy<objective_fn::Gaussian, false>::score(a_cum_[j] - a_cum_[i], b_cum_[j] - b_cum_[i]);
     }
     
     double compute_score_riskpart_optimized(int i, int j) override {
-      double score = a_sums_[i][j]*a_sums_[i][j]/2./b_sums_[i][j];
-      return score;
+      return ScorePolicy<objective_fn::Gaussian, true>::score(a_cum_[j] - a_cum_[i], b_cum_[j] - b_cum_[i]);
     }
 
   };
 
-  class RationalScoreContext : public ParametricContext {
+  template<typename DataType>
+  class RationalScoreContext : public ParametricContext<DataType> {
     // This class doesn't correspond to any regular exponential family,
     // it is used to define ambient functions on the partition polytope
     // for targeted applications - quadratic approximations to loss, for
     // XGBoost, e.g.
 
+  protected:
+    using ParametricContext<DataType>::a_;
+    using ParametricContext<DataType>::b_;
+    using ParametricContext<DataType>::a_cum_;
+    using ParametricContext<DataType>::b_cum_;
+    using ParametricContext<DataType>::compute_partial_sums;
+
   public:
-    RationalScoreContext(std::vector<double> a,
-			 std::vector<double> b,
+    RationalScoreContext(const DataType* a,
+			 const DataType* b,
 			 int n,
 			 bool risk_partitioning_objective,
-			 bool use_rational_optimization) : ParametricContext(a,
-									     b,
-									     n,
-									     risk_partitioning_objective,
-									     use_rational_optimization,
-									     "RationalScore")
+			 bool use_rational_optimization) : ParametricContext<DataType>(a,
+										       b,
+										       n,
+										       risk_partitioning_objective,
+										       use_rational_optimization,
+										       "RationalScore")
     { if (use_rational_optimization) {
 	compute_partial_sums();
       }
     }
-
-    void compute_partial_sums() override {
-      double a_cum;
-      a_sums_ = std::vector<std::vector<double> >(n_, std::vector<double>(n_+1, std::numeric_limits<double>::lowest()));
-      b_sums_ = std::vector<std::vector<double> >(n_, std::vector<double>(n_+1, std::numeric_limits<double>::lowest()));
-    
-      for (int i=0; i<n_; ++i) {
-	a_sums_[i][i] = 0.;
-	b_sums_[i][i] = 0.;
-      }
-
-      for (int i=0; i<n_; ++i) {
-	a_cum = -a_[i-1];
-	for (int j=i+1; j<=n_; ++j) {
-	  a_cum += a_[j-2];
-	  a_sums_[i][j] = a_sums_[i][j-1] + (2*a_cum + a_[j-1])*a_[j-1];
-	  b_sums_[i][j] = b_sums_[i][j-1] + b_[j-1];
-	}
-      }  
-    }
   
     double compute_score_multclust(int i, int j) override {
-      double score = std::pow(std::accumulate(a_.cbegin()+i, a_.cbegin()+j, 0.), 2) /
-	std::accumulate(b_.cbegin()+i, b_.cbegin()+j, 0.);
+      double score = std::pow(std::accumulate(a_+i, a_+j, 0.), 2) /
+	std::accumulate(b_+i, b_+j, 0.);
       return score;
     }
   
@@ -296,16 +359,17 @@ namespace Objectives {
     }
 
     double compute_score_multclust_optimized(int i, int j) override {
-      double score = a_sums_[i][j] / b_sums_[i][j];
-      return score;
+      // quadratic term (sum(a_[i:j]))^2 from the cumulative sums directly,
+      // no need to accumulate the cross terms
+      return ScorePolicy<objective_fn::RationalScore, false>::score(a_cum_[j] - a_cum_[i], b_cum_[j] - b_cum_[i]);
     }
 
     double compute_ambient_score_multclust(double a, double b) override {
-      return a*a/b;
+      return ScorePolicy<objective_fn::RationalScore, false>::score(a, b);
     }
 
     double compute_ambient_score_riskpart(double a, double b) override {
-      return a*a/b;
+      return ScorePolicy<objective_fn::RationalScore, true>::score(a, b);
     }
 
   };
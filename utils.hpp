@@ -7,6 +7,36 @@ namespace Utils {
       return "Bad distributional assignment";
     };
   };
+
+  struct regularizationPathException : public std::exception {
+    const char* what() const throw () {
+      return "Regularization path requires the full DP table";
+    };
+  };
+
+  struct memoryBudgetException : public std::exception {
+    const char* what() const throw () {
+      return "No DP engine fits the memory budget";
+    };
+  };
+
+  struct tableMappingException : public std::exception {
+    const char* what() const throw () {
+      return "Could not map a DP table to a temporary file";
+    };
+  };
+
+  struct segmentLengthException : public std::exception {
+    const char* what() const throw () {
+      return "No partition meets the segment length bounds";
+    };
+  };
+
+  struct partitionSizeException : public std::exception {
+    const char* what() const throw () {
+      return "More subsets than points to partition";
+    };
+  };
 }
 
 #endif